@@ -4,16 +4,28 @@ mod_def = Extension(
     name='pyglfs',
     sources=[
         'src/pyglfs.c',
+        'src/pyglfs-bcache.c',
+        'src/pyglfs-cache.c',
+        'src/pyglfs-dcache.c',
+        'src/pyglfs-dir.c',
         'src/pyglfs-fd.c',
+        'src/pyglfs-fdpool.c',
         'src/pyglfs-fts.c',
         'src/pyglfs-handle.c',
         'src/pyglfs-iter.c',
+        'src/pyglfs-lease.c',
+        'src/pyglfs-profile.c',
+        'src/pyglfs-reaper.c',
         'src/pyglfs-stat.c',
-        'src/pyglfs-volume.c'
+        'src/pyglfs-threads.c',
+        'src/pyglfs-upcall.c',
+        'src/pyglfs-volume.c',
+        'src/pyglfs-watch.c'
     ],
     libraries=[
         'gfapi',
         'bsd',
+        'pthread',
     ],
     include_dirs=[
         '/usr/include/glusterfs'
@@ -0,0 +1,240 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Volume block cache.
+ *
+ * File data read through any FD on the volume is cached in fixed size
+ * blocks keyed by (gfid, block number) in a byte-bounded LRU cache, so
+ * that it is shared between FDs for the same file. A block shorter than
+ * the block size marks EOF.
+ *
+ * When an FD reads sequentially the read that fills a missing block is
+ * extended by a readahead window that grows by one block per sequential
+ * read, up to BCACHE_MAX_READAHEAD blocks. Reads spanning more than
+ * BCACHE_MAX_READ_BLOCKS blocks bypass the cache.
+ *
+ * Writes and truncates through pyglfs drop the blocks they overlap and
+ * the block that held the previous EOF, located through the pre-op
+ * size of the file. Changes from other clients are handled through
+ * upcalls and TTL.
+ *
+ * A fill may race with an invalidation, leaving blocks read before the
+ * change in the cache. Invalidations bump the volume's block_cache_gen
+ * before dropping blocks, and a fill that sees the generation change
+ * while it was reading drops the blocks it inserted.
+ */
+
+#define BCACHE_MAX_READAHEAD	8
+#define BCACHE_MAX_READ_BLOCKS	64
+
+#define BCACHE_KEY_SIZE (sizeof(uuid_t) + sizeof(uint64_t))
+
+static void bcache_key(unsigned char *key,
+		       const unsigned char *gfid,
+		       uint64_t block)
+{
+	memcpy(key, gfid, sizeof(uuid_t));
+	memcpy(key + sizeof(uuid_t), &block, sizeof(block));
+}
+
+/*
+ * Read blocks first through last in a single request, add them to the
+ * cache and copy up to cnt bytes starting at boff into buf.
+ */
+static ssize_t bcache_fill(py_glfs_fd_t *fd,
+			   uint64_t first,
+			   uint64_t last,
+			   char *buf,
+			   size_t boff,
+			   size_t cnt)
+{
+	py_glfs_t *py_fs = fd->parent->py_fs;
+	size_t bs = py_fs->block_size;
+	size_t nblocks = last - first + 1;
+	unsigned char key[BCACHE_KEY_SIZE];
+	char *tmp = NULL;
+	ssize_t n, copied;
+	uint64_t gen;
+	size_t i, added = 0;
+
+	tmp = malloc(nblocks * bs);
+	if (tmp == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	gen = __atomic_load_n(&py_fs->block_cache_gen, __ATOMIC_SEQ_CST);
+	n = glfs_pread(fd->fd, tmp, nblocks * bs, first * bs, 0, NULL);
+	if (n == -1) {
+		free(tmp);
+		return -1;
+	}
+
+	for (i = 0; i < nblocks; i++) {
+		size_t len = ((size_t)n > i * bs) ? Py_MIN(bs, n - i * bs) : 0;
+
+		bcache_key(key, fd->parent->gfid, first + i);
+		pyglfs_cache_put(py_fs->block_cache, key, sizeof(key),
+				 tmp + (i * bs), len);
+		added++;
+		if (len < bs) {
+			/* EOF. Short (or empty) block is cached to record it */
+			break;
+		}
+	}
+
+	/* data may predate a write that completed during the read */
+	if (__atomic_load_n(&py_fs->block_cache_gen, __ATOMIC_SEQ_CST) != gen) {
+		for (i = 0; i < added; i++) {
+			bcache_key(key, fd->parent->gfid, first + i);
+			pyglfs_cache_remove(py_fs->block_cache, key,
+					    sizeof(key));
+		}
+	}
+
+	copied = ((size_t)n > boff) ? Py_MIN(cnt, n - boff) : 0;
+	memcpy(buf, tmp + boff, copied);
+	free(tmp);
+
+	return copied;
+}
+
+/*
+ * pread() through the volume block cache. Called without the GIL.
+ */
+ssize_t pyglfs_bcache_pread(py_glfs_fd_t *fd,
+			    char *buf,
+			    size_t cnt,
+			    off_t offset)
+{
+	py_glfs_t *py_fs = fd->parent->py_fs;
+	size_t bs = py_fs->block_size;
+	unsigned char key[BCACHE_KEY_SIZE];
+	uint64_t last;
+	size_t done = 0, ra;
+
+	if ((cnt == 0) || (offset < 0) ||
+	    ((cnt / bs) >= BCACHE_MAX_READ_BLOCKS)) {
+		return glfs_pread(fd->fd, buf, cnt, offset, 0, NULL);
+	}
+
+	/* FD is not locked, so this is only a hint */
+	if (offset == fd->seq_next) {
+		if (fd->seq_run < BCACHE_MAX_READAHEAD) {
+			fd->seq_run++;
+		}
+	} else {
+		fd->seq_run = 0;
+	}
+	fd->seq_next = offset + cnt;
+	ra = fd->seq_run;
+
+	last = (offset + cnt - 1) / bs;
+
+	while (done < cnt) {
+		uint64_t pos = offset + done;
+		uint64_t block = pos / bs;
+		size_t boff = pos % bs;
+		size_t want = Py_MIN(bs - boff, cnt - done);
+		ssize_t n;
+
+		bcache_key(key, fd->parent->gfid, block);
+		n = pyglfs_cache_get_range(py_fs->block_cache, key, sizeof(key),
+					   buf + done, boff, want);
+		if (n == -1) {
+			/* fetch rest of request and readahead window at once */
+			n = bcache_fill(fd, block, last + ra, buf + done,
+					boff, cnt - done);
+			if (n == -1) {
+				return -1;
+			}
+			done += n;
+			break;
+		}
+
+		done += n;
+		if ((size_t)n < want) {
+			/* EOF */
+			break;
+		}
+	}
+
+	return done;
+}
+
+static bool bcache_gfid_match(const void *key, size_t klen,
+			      const void *val, size_t vlen,
+			      void *private)
+{
+	return memcmp(key, private, sizeof(uuid_t)) == 0;
+}
+
+/*
+ * Drop all cached blocks of file. This scans the whole cache, prefer
+ * pyglfs_bcache_invalidate_range() when the affected range is known.
+ */
+void pyglfs_bcache_invalidate(py_glfs_t *py_fs, const unsigned char *gfid)
+{
+	if (py_fs->block_cache == NULL) {
+		return;
+	}
+
+	__atomic_add_fetch(&py_fs->block_cache_gen, 1, __ATOMIC_SEQ_CST);
+	pyglfs_cache_remove_if(py_fs->block_cache, bcache_gfid_match,
+			       discard_const(gfid));
+}
+
+/*
+ * Drop cached blocks of file overlapping bytes start through end
+ * (inclusive) after it is modified through pyglfs.
+ */
+void pyglfs_bcache_invalidate_range(py_glfs_t *py_fs,
+				    const unsigned char *gfid,
+				    uint64_t start,
+				    uint64_t end)
+{
+	unsigned char key[BCACHE_KEY_SIZE];
+	pyglfs_cache_stats_t stats;
+	uint64_t block, last;
+
+	if (py_fs->block_cache == NULL) {
+		return;
+	}
+
+	block = start / py_fs->block_size;
+	last = end / py_fs->block_size;
+
+	/* removing keys one by one costs more than a scan */
+	pyglfs_cache_get_stats(py_fs->block_cache, &stats);
+	if (last - block >= stats.entries) {
+		pyglfs_bcache_invalidate(py_fs, gfid);
+		return;
+	}
+
+	__atomic_add_fetch(&py_fs->block_cache_gen, 1, __ATOMIC_SEQ_CST);
+	for (; block <= last; block++) {
+		bcache_key(key, gfid, block);
+		pyglfs_cache_remove(py_fs->block_cache, key, sizeof(key));
+	}
+}
@@ -0,0 +1,796 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include <time.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * General purpose client-side cache.
+ *
+ * Entries are keyed by arbitrary byte strings (typically a gfid, possibly
+ * followed by more data) and hold a copy of a small value. Lookups copy the
+ * value out to the caller, so no references to cache memory escape the
+ * lock. Entries expire after the configured TTL and the least recently
+ * used entry is evicted when the entry limit (or optional limit on
+ * total size of values) is reached.
+ *
+ * All functions may be called without the GIL and accept a NULL cache,
+ * which behaves as a disabled cache.
+ */
+
+typedef struct cache_entry {
+	struct cache_entry *hnext;	/* hash chain */
+	struct cache_entry *prev;	/* LRU list, head is most recent */
+	struct cache_entry *next;
+	uint64_t hash;
+	uint64_t expires;		/* monotonic ns, 0 is never */
+	size_t klen;
+	size_t vlen;
+	size_t cost;			/* accounted against max_bytes */
+	unsigned char data[];		/* key followed by value */
+} cache_entry_t;
+
+struct pyglfs_cache {
+	pthread_mutex_t lock;
+	cache_entry_t **buckets;
+	size_t nbuckets;
+	cache_entry_t lru;		/* list sentinel */
+	size_t entries;
+	size_t max_entries;
+	size_t bytes;			/* sum of entry costs */
+	size_t max_bytes;		/* 0 is unlimited */
+	pyglfs_cache_evict_fn_t on_evict;
+	void *evict_private;
+	cache_entry_t *evicted;		/* on_evict pending, see cache_unlock() */
+	uint64_t ttl;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invalidations;
+};
+
+#define CACHE_MIN_BUCKETS 64
+
+uint64_t pyglfs_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+pyglfs_cache_t *pyglfs_cache_new(size_t max_entries, uint64_t ttl_ns)
+{
+	pyglfs_cache_t *cache = NULL;
+
+	cache = calloc(1, sizeof(pyglfs_cache_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->nbuckets = CACHE_MIN_BUCKETS;
+	cache->buckets = calloc(cache->nbuckets, sizeof(cache_entry_t *));
+	if (cache->buckets == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->lru.next = cache->lru.prev = &cache->lru;
+	cache->max_entries = max_entries;
+	cache->ttl = ttl_ns;
+
+	return cache;
+}
+
+/*
+ * Limit total size of values held in cache. Must be set before
+ * cache is used.
+ */
+void pyglfs_cache_set_max_bytes(pyglfs_cache_t *cache, size_t max_bytes)
+{
+	cache->max_bytes = max_bytes;
+}
+
+/*
+ * Register callback for entries leaving the cache through eviction,
+ * expiry, invalidation or replacement by a different value. It is
+ * not called when the cache is freed. Callback runs after the cache
+ * lock is dropped, in the thread that removed the entry, so it may be
+ * slow (e.g. a network RPC) without stalling other users of the cache.
+ */
+void pyglfs_cache_set_evict_cb(pyglfs_cache_t *cache,
+			       pyglfs_cache_evict_fn_t fn,
+			       void *private)
+{
+	cache->on_evict = fn;
+	cache->evict_private = private;
+}
+
+static cache_entry_t **cache_find_slot(pyglfs_cache_t *cache,
+				       const void *key,
+				       size_t klen,
+				       uint64_t hash)
+{
+	cache_entry_t **slot = &cache->buckets[hash & (cache->nbuckets - 1)];
+
+	for (; *slot != NULL; slot = &(*slot)->hnext) {
+		if (((*slot)->hash == hash) && ((*slot)->klen == klen) &&
+		    (memcmp((*slot)->data, key, klen) == 0)) {
+			break;
+		}
+	}
+
+	return slot;
+}
+
+/*
+ * Remove entry from cache. Unless the entry is only being freed with
+ * the cache, it is queued for on_evict, which cache_unlock() calls.
+ */
+static void cache_unlink_entry(pyglfs_cache_t *cache,
+			       cache_entry_t *entry,
+			       bool notify)
+{
+	cache_entry_t **slot = NULL;
+
+	slot = &cache->buckets[entry->hash & (cache->nbuckets - 1)];
+	while (*slot != entry) {
+		slot = &(*slot)->hnext;
+	}
+
+	*slot = entry->hnext;
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	cache->entries--;
+	cache->bytes -= entry->cost;
+	if (notify && (cache->on_evict != NULL)) {
+		entry->hnext = cache->evicted;
+		cache->evicted = entry;
+		return;
+	}
+	free(entry);
+}
+
+/* drop cache lock, then run on_evict for entries removed under it */
+static void cache_unlock(pyglfs_cache_t *cache)
+{
+	cache_entry_t *entry = cache->evicted;
+
+	cache->evicted = NULL;
+	pthread_mutex_unlock(&cache->lock);
+
+	while (entry != NULL) {
+		cache_entry_t *next = entry->hnext;
+
+		cache->on_evict(entry->data, entry->klen,
+				entry->data + entry->klen, entry->vlen,
+				cache->evict_private);
+		free(entry);
+		entry = next;
+	}
+}
+
+static void cache_lru_push(pyglfs_cache_t *cache, cache_entry_t *entry)
+{
+	entry->next = cache->lru.next;
+	entry->prev = &cache->lru;
+	cache->lru.next->prev = entry;
+	cache->lru.next = entry;
+}
+
+static void cache_grow(pyglfs_cache_t *cache)
+{
+	cache_entry_t **buckets = NULL;
+	size_t nbuckets = cache->nbuckets * 2;
+	size_t i;
+
+	buckets = calloc(nbuckets, sizeof(cache_entry_t *));
+	if (buckets == NULL) {
+		/* keep longer chains */
+		return;
+	}
+
+	for (i = 0; i < cache->nbuckets; i++) {
+		cache_entry_t *entry = cache->buckets[i];
+
+		while (entry != NULL) {
+			cache_entry_t *next = entry->hnext;
+			size_t idx = entry->hash & (nbuckets - 1);
+
+			entry->hnext = buckets[idx];
+			buckets[idx] = entry;
+			entry = next;
+		}
+	}
+
+	free(cache->buckets);
+	cache->buckets = buckets;
+	cache->nbuckets = nbuckets;
+}
+
+bool pyglfs_cache_get(pyglfs_cache_t *cache,
+		      const void *key, size_t klen,
+		      void *val, size_t vlen)
+{
+	cache_entry_t *entry = NULL;
+	bool found = false;
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry = *cache_find_slot(cache, key, klen, pyglfs_hash(key, klen));
+	if ((entry != NULL) && entry->expires &&
+	    (entry->expires < pyglfs_now_ns())) {
+		cache_unlink_entry(cache, entry, true);
+		cache->evictions++;
+		entry = NULL;
+	}
+
+	if ((entry != NULL) && (entry->vlen == vlen)) {
+		/* move to head of LRU list */
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+		cache_lru_push(cache, entry);
+		memcpy(val, entry->data + klen, vlen);
+		cache->hits++;
+		found = true;
+	} else {
+		cache->misses++;
+	}
+	cache_unlock(cache);
+
+	return found;
+}
+
+/*
+ * Remove entry and copy its value out. Whatever the value refers to is
+ * now owned by the caller, so on_evict is not called.
+ */
+bool pyglfs_cache_take(pyglfs_cache_t *cache,
+		       const void *key, size_t klen,
+		       void *val, size_t vlen)
+{
+	cache_entry_t *entry = NULL;
+	bool found = false;
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry = *cache_find_slot(cache, key, klen, pyglfs_hash(key, klen));
+	if ((entry != NULL) && entry->expires &&
+	    (entry->expires < pyglfs_now_ns())) {
+		cache_unlink_entry(cache, entry, true);
+		cache->evictions++;
+		entry = NULL;
+	}
+
+	if ((entry != NULL) && (entry->vlen == vlen)) {
+		memcpy(val, entry->data + klen, vlen);
+		cache_unlink_entry(cache, entry, false);
+		cache->hits++;
+		found = true;
+	} else {
+		cache->misses++;
+	}
+	cache_unlock(cache);
+
+	return found;
+}
+
+/*
+ * Evict expired entries from the least recently used end, stopping at
+ * the first live entry. This is exact for caches whose entries are not
+ * moved by lookups, i.e. that are only accessed through
+ * pyglfs_cache_take().
+ */
+size_t pyglfs_cache_expire(pyglfs_cache_t *cache)
+{
+	uint64_t now = pyglfs_now_ns();
+	size_t removed = 0;
+
+	if ((cache == NULL) || (cache->ttl == 0)) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	while ((cache->lru.prev != &cache->lru) &&
+	       (cache->lru.prev->expires < now)) {
+		cache_unlink_entry(cache, cache->lru.prev, true);
+		cache->evictions++;
+		removed++;
+	}
+	cache_unlock(cache);
+
+	return removed;
+}
+
+/*
+ * Copy up to len bytes of value starting at off. Unlike
+ * pyglfs_cache_get() values may be of any size. Returns number of
+ * bytes copied, or -1 if key is not cached.
+ */
+ssize_t pyglfs_cache_get_range(pyglfs_cache_t *cache,
+			       const void *key, size_t klen,
+			       void *buf, size_t off, size_t len)
+{
+	cache_entry_t *entry = NULL;
+	ssize_t copied = -1;
+
+	if (cache == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry = *cache_find_slot(cache, key, klen, pyglfs_hash(key, klen));
+	if ((entry != NULL) && entry->expires &&
+	    (entry->expires < pyglfs_now_ns())) {
+		cache_unlink_entry(cache, entry, true);
+		cache->evictions++;
+		entry = NULL;
+	}
+
+	if (entry != NULL) {
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+		cache_lru_push(cache, entry);
+		copied = (off < entry->vlen) ? Py_MIN(len, entry->vlen - off) : 0;
+		memcpy(buf, entry->data + klen + off, copied);
+		cache->hits++;
+	} else {
+		cache->misses++;
+	}
+	cache_unlock(cache);
+
+	return copied;
+}
+
+bool pyglfs_cache_put(pyglfs_cache_t *cache,
+		      const void *key, size_t klen,
+		      const void *val, size_t vlen)
+{
+	return pyglfs_cache_put_cost(cache, key, klen, val, vlen, vlen);
+}
+
+/*
+ * Insert entry that accounts for `cost` bytes against the max_bytes
+ * limit rather than the size of the value, e.g. when the value only
+ * describes data held elsewhere.
+ */
+bool pyglfs_cache_put_cost(pyglfs_cache_t *cache,
+			   const void *key, size_t klen,
+			   const void *val, size_t vlen,
+			   size_t cost)
+{
+	cache_entry_t *entry = NULL, **slot = NULL;
+	uint64_t hash;
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	entry = malloc(sizeof(cache_entry_t) + klen + vlen);
+	if (entry == NULL) {
+		return false;
+	}
+
+	hash = pyglfs_hash(key, klen);
+	entry->hash = hash;
+	entry->klen = klen;
+	entry->vlen = vlen;
+	entry->cost = cost;
+	entry->hnext = NULL;
+	memcpy(entry->data, key, klen);
+	memcpy(entry->data + klen, val, vlen);
+	entry->expires = cache->ttl ? pyglfs_now_ns() + cache->ttl : 0;
+
+	pthread_mutex_lock(&cache->lock);
+	slot = cache_find_slot(cache, key, klen, hash);
+	if (*slot != NULL) {
+		bool same = ((*slot)->vlen == vlen) &&
+		    (memcmp((*slot)->data + klen, val, vlen) == 0);
+
+		cache_unlink_entry(cache, *slot, !same);
+	}
+
+	if (cache->max_bytes && (cost > cache->max_bytes)) {
+		cache_unlock(cache);
+		free(entry);
+		return false;
+	}
+
+	while (cache->entries &&
+	       ((cache->entries >= cache->max_entries) ||
+		(cache->max_bytes && (cache->bytes + cost > cache->max_bytes)))) {
+		cache_unlink_entry(cache, cache->lru.prev, true);
+		cache->evictions++;
+	}
+
+	if (cache->entries >= cache->nbuckets) {
+		cache_grow(cache);
+	}
+
+	slot = &cache->buckets[hash & (cache->nbuckets - 1)];
+	entry->hnext = *slot;
+	*slot = entry;
+	cache_lru_push(cache, entry);
+	cache->entries++;
+	cache->bytes += cost;
+	cache_unlock(cache);
+
+	return true;
+}
+
+bool pyglfs_cache_remove(pyglfs_cache_t *cache, const void *key, size_t klen)
+{
+	cache_entry_t *entry = NULL;
+
+	if (cache == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry = *cache_find_slot(cache, key, klen, pyglfs_hash(key, klen));
+	if (entry != NULL) {
+		cache_unlink_entry(cache, entry, true);
+		cache->invalidations++;
+	}
+	cache_unlock(cache);
+
+	return entry != NULL;
+}
+
+void pyglfs_cache_clear(pyglfs_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	while (cache->lru.next != &cache->lru) {
+		cache_unlink_entry(cache, cache->lru.next, true);
+		cache->invalidations++;
+	}
+	cache_unlock(cache);
+}
+
+/*
+ * Remove all entries for which match() returns true. match() is called
+ * with the cache lock held and must not call back into the cache.
+ */
+size_t pyglfs_cache_remove_if(pyglfs_cache_t *cache,
+			      pyglfs_cache_match_fn_t match,
+			      void *private)
+{
+	cache_entry_t *entry = NULL, *next = NULL;
+	size_t removed = 0;
+
+	if (cache == NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	for (entry = cache->lru.next; entry != &cache->lru; entry = next) {
+		next = entry->next;
+		if (match(entry->data, entry->klen,
+			  entry->data + entry->klen, entry->vlen, private)) {
+			cache_unlink_entry(cache, entry, true);
+			cache->invalidations++;
+			removed++;
+		}
+	}
+	cache_unlock(cache);
+
+	return removed;
+}
+
+void pyglfs_cache_free(pyglfs_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	while (cache->lru.next != &cache->lru) {
+		cache_unlink_entry(cache, cache->lru.next, false);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->buckets);
+	free(cache);
+}
+
+void pyglfs_cache_get_stats(pyglfs_cache_t *cache, pyglfs_cache_stats_t *stats)
+{
+	pthread_mutex_lock(&cache->lock);
+	*stats = (pyglfs_cache_stats_t) {
+		.hits = cache->hits,
+		.misses = cache->misses,
+		.evictions = cache->evictions,
+		.invalidations = cache->invalidations,
+		.entries = cache->entries,
+		.max_entries = cache->max_entries,
+		.bytes = cache->bytes,
+		.max_bytes = cache->max_bytes,
+		.ttl_ns = cache->ttl,
+	};
+	pthread_mutex_unlock(&cache->lock);
+}
+
+PyObject *pyglfs_cache_stats_to_dict(pyglfs_cache_t *cache)
+{
+	pyglfs_cache_stats_t stats;
+
+	if (cache == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	pyglfs_cache_get_stats(cache, &stats);
+	return Py_BuildValue(
+		"{s:K,s:K,s:K,s:K,s:n,s:n,s:n,s:n,s:d}",
+		"hits", (unsigned long long)stats.hits,
+		"misses", (unsigned long long)stats.misses,
+		"evictions", (unsigned long long)stats.evictions,
+		"invalidations", (unsigned long long)stats.invalidations,
+		"entries", (Py_ssize_t)stats.entries,
+		"max_entries", (Py_ssize_t)stats.max_entries,
+		"bytes", (Py_ssize_t)stats.bytes,
+		"max_bytes", (Py_ssize_t)stats.max_bytes,
+		"ttl", (double)stats.ttl_ns / 1000000000.0
+	);
+}
+
+/*
+ * Attribute cache. Maps gfid to the most recent stat information
+ * seen for the object from any source (lookup, stat, readdirplus).
+ */
+void pyglfs_attr_cache_put(py_glfs_t *py_fs,
+			   const unsigned char *gfid,
+			   const struct stat *st)
+{
+	pyglfs_cache_put(py_fs->attr_cache, gfid, sizeof(uuid_t),
+			 st, sizeof(struct stat));
+}
+
+bool pyglfs_attr_cache_get(py_glfs_t *py_fs,
+			   const unsigned char *gfid,
+			   struct stat *st)
+{
+	return pyglfs_cache_get(py_fs->attr_cache, gfid, sizeof(uuid_t),
+				st, sizeof(struct stat));
+}
+
+void pyglfs_attr_cache_invalidate(py_glfs_t *py_fs, const unsigned char *gfid)
+{
+	pyglfs_cache_remove(py_fs->attr_cache, gfid, sizeof(uuid_t));
+}
+
+/*
+ * Dentry cache. Maps (parent gfid, name) to the gfid of the child, or
+ * records that the name does not exist (negative entry). Symlinks are
+ * never cached so that entries are valid regardless of whether the
+ * caller follows symlinks.
+ */
+typedef struct {
+	uuid_t gfid;
+	bool negative;
+} dentry_val_t;
+
+static size_t dentry_key(unsigned char *key,
+			 const unsigned char *parent,
+			 const char *name,
+			 size_t len)
+{
+	memcpy(key, parent, sizeof(uuid_t));
+	memcpy(key + sizeof(uuid_t), name, len);
+	return sizeof(uuid_t) + len;
+}
+
+void pyglfs_dentry_cache_put(py_glfs_t *py_fs,
+			     const unsigned char *parent,
+			     const char *name,
+			     size_t len,
+			     const unsigned char *child)
+{
+	unsigned char key[sizeof(uuid_t) + NAME_MAX];
+	dentry_val_t val = { .negative = (child == NULL) };
+
+	if ((py_fs->dentry_cache == NULL) || (len > NAME_MAX)) {
+		return;
+	}
+
+	if (child != NULL) {
+		memcpy(val.gfid, child, sizeof(uuid_t));
+	}
+
+	pyglfs_cache_put(py_fs->dentry_cache, key,
+			 dentry_key(key, parent, name, len),
+			 &val, sizeof(val));
+}
+
+bool pyglfs_dentry_cache_get(py_glfs_t *py_fs,
+			     const unsigned char *parent,
+			     const char *name,
+			     size_t len,
+			     unsigned char *child,
+			     bool *negative)
+{
+	unsigned char key[sizeof(uuid_t) + NAME_MAX];
+	dentry_val_t val;
+
+	if ((py_fs->dentry_cache == NULL) || (len > NAME_MAX)) {
+		return false;
+	}
+
+	if (!pyglfs_cache_get(py_fs->dentry_cache, key,
+			      dentry_key(key, parent, name, len),
+			      &val, sizeof(val))) {
+		return false;
+	}
+
+	*negative = val.negative;
+	memcpy(child, val.gfid, sizeof(uuid_t));
+	return true;
+}
+
+void pyglfs_dentry_cache_invalidate(py_glfs_t *py_fs,
+				    const unsigned char *parent,
+				    const char *name,
+				    size_t len)
+{
+	unsigned char key[sizeof(uuid_t) + NAME_MAX];
+
+	if ((py_fs->dentry_cache == NULL) || (len > NAME_MAX)) {
+		return;
+	}
+
+	pyglfs_cache_remove(py_fs->dentry_cache, key,
+			    dentry_key(key, parent, name, len));
+}
+
+/*
+ * Upcall subscriber that evicts entries changed by other clients.
+ *
+ * Stat information is dropped for the inode and its parents. Dentries
+ * are dropped for any directory named in the event (the parent's
+ * entries may have changed), and dentries pointing to the inode are
+ * dropped if the event indicates that its names may have changed.
+ * Cached data blocks of the inode are dropped. Dentry and block
+ * eviction require a scan of the cache, and so are performed once per
+ * batch of events.
+ */
+#define UP_NAME_FLAGS (GFAPI_UP_NLINK | GFAPI_UP_RENAME | GFAPI_UP_FORGET)
+
+struct gfid_set {
+	unsigned char (*dirs)[sizeof(uuid_t)];
+	size_t ndirs;
+	unsigned char (*children)[sizeof(uuid_t)];
+	size_t nchildren;
+};
+
+static int gfid_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, sizeof(uuid_t));
+}
+
+/* key starts with gfid of a directory or file named in events */
+static bool gfid_prefix_match(const void *key, size_t klen,
+			      const void *val, size_t vlen,
+			      void *private)
+{
+	struct gfid_set *set = (struct gfid_set *)private;
+
+	return bsearch(key, set->dirs, set->ndirs, sizeof(uuid_t), gfid_cmp);
+}
+
+static bool dentry_upcall_match(const void *key, size_t klen,
+				const void *val, size_t vlen,
+				void *private)
+{
+	struct gfid_set *set = (struct gfid_set *)private;
+	const dentry_val_t *dval = (const dentry_val_t *)val;
+
+	/* key starts with parent gfid */
+	if (gfid_prefix_match(key, klen, val, vlen, private)) {
+		return true;
+	}
+
+	return !dval->negative &&
+	    bsearch(dval->gfid, set->children, set->nchildren,
+		    sizeof(uuid_t), gfid_cmp);
+}
+
+void pyglfs_cache_upcall_cb(const pyglfs_upcall_event_t *events,
+			    size_t cnt, void *private)
+{
+	py_glfs_t *py_fs = (py_glfs_t *)private;
+	struct gfid_set set = { 0 };
+	size_t i;
+
+	/* discard blocks being read concurrently, see pyglfs-bcache.c */
+	if (py_fs->block_cache != NULL) {
+		__atomic_add_fetch(&py_fs->block_cache_gen, 1,
+				   __ATOMIC_SEQ_CST);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (events[i].flags & PYGLFS_UPCALL_OVERFLOW) {
+			pyglfs_cache_clear(py_fs->attr_cache);
+			pyglfs_cache_clear(py_fs->dentry_cache);
+			pyglfs_cache_clear(py_fs->block_cache);
+			pyglfs_cache_clear(py_fs->fd_pool);
+			return;
+		}
+	}
+
+	for (i = 0; i < cnt; i++) {
+		pyglfs_attr_cache_invalidate(py_fs, events[i].gfid);
+		if (!uuid_is_null(events[i].pgfid)) {
+			pyglfs_attr_cache_invalidate(py_fs, events[i].pgfid);
+		}
+		if (!uuid_is_null(events[i].oldpgfid)) {
+			pyglfs_attr_cache_invalidate(py_fs, events[i].oldpgfid);
+		}
+	}
+
+	if ((py_fs->dentry_cache == NULL) && (py_fs->block_cache == NULL) &&
+	    (py_fs->fd_pool == NULL)) {
+		return;
+	}
+
+	set.dirs = calloc(cnt * 3, sizeof(uuid_t));
+	set.children = calloc(cnt, sizeof(uuid_t));
+	if ((set.dirs == NULL) || (set.children == NULL)) {
+		pyglfs_cache_clear(py_fs->dentry_cache);
+		pyglfs_cache_clear(py_fs->block_cache);
+		pyglfs_cache_clear(py_fs->fd_pool);
+		goto out;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		memcpy(set.dirs[set.ndirs++], events[i].gfid, sizeof(uuid_t));
+		if (!uuid_is_null(events[i].pgfid)) {
+			memcpy(set.dirs[set.ndirs++], events[i].pgfid,
+			       sizeof(uuid_t));
+		}
+		if (!uuid_is_null(events[i].oldpgfid)) {
+			memcpy(set.dirs[set.ndirs++], events[i].oldpgfid,
+			       sizeof(uuid_t));
+		}
+		if (events[i].flags & UP_NAME_FLAGS) {
+			memcpy(set.children[set.nchildren++], events[i].gfid,
+			       sizeof(uuid_t));
+		}
+	}
+
+	qsort(set.dirs, set.ndirs, sizeof(uuid_t), gfid_cmp);
+	qsort(set.children, set.nchildren, sizeof(uuid_t), gfid_cmp);
+	pyglfs_cache_remove_if(py_fs->dentry_cache, dentry_upcall_match, &set);
+	pyglfs_cache_remove_if(py_fs->block_cache, gfid_prefix_match, &set);
+	pyglfs_cache_remove_if(py_fs->fd_pool, gfid_prefix_match, &set);
+
+out:
+	free(set.dirs);
+	free(set.children);
+}
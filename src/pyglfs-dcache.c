@@ -0,0 +1,412 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Persistent local disk cache of whole files.
+ *
+ * Files are stored in the cache directory under the name
+ * <gfid>.<size>.<mtime ns>.<ctime ns>, so that a cached copy is only
+ * used while the remote file is unchanged. An in-memory index maps gfid
+ * to the cached version, with the file size accounted against the size
+ * limit of the cache. When an entry is evicted from the index the local
+ * file is removed. The index is rebuilt from the directory contents when
+ * the volume is opened, and so the cache survives restarts.
+ *
+ * Read-only FDs are checked against the cache with glfs_h_stat() when
+ * opened. If there is a valid copy, pread() is served from the local
+ * file. Otherwise data read sequentially from the start of the file is
+ * written to a temporary file which is moved into the cache once EOF
+ * is reached, so populating the cache costs no extra remote I/O.
+ */
+
+#define DCACHE_TMP_PREFIX ".tmp-"
+
+typedef struct {
+	int64_t size;
+	int64_t mtime_ns;
+	int64_t ctime_ns;
+} dcache_ver_t;
+
+struct pyglfs_dcache {
+	char dir[PATH_MAX];
+	pyglfs_cache_t *index;
+};
+
+struct pyglfs_dcache_fill {
+	pthread_mutex_t lock;
+	int fd;
+	off_t pos;
+	uuid_t gfid;
+	dcache_ver_t ver;
+	char path[PATH_MAX];
+};
+
+static void dcache_ver_from_stat(dcache_ver_t *ver, const struct stat *st)
+{
+	ver->size = st->st_size;
+	ver->mtime_ns = (st->st_mtim.tv_sec * 1000000000LL) + st->st_mtim.tv_nsec;
+	ver->ctime_ns = (st->st_ctim.tv_sec * 1000000000LL) + st->st_ctim.tv_nsec;
+}
+
+/* returns false if the path does not fit into sz bytes */
+static bool dcache_path(const pyglfs_dcache_t *dc,
+			const unsigned char *gfid,
+			const dcache_ver_t *ver,
+			char *path, size_t sz)
+{
+	char uuid_str[37];
+	int n;
+
+	uuid_unparse(gfid, uuid_str);
+	n = snprintf(path, sz, "%s/%s.%ld.%ld.%ld", dc->dir, uuid_str,
+		     (long)ver->size, (long)ver->mtime_ns,
+		     (long)ver->ctime_ns);
+	return (n >= 0) && ((size_t)n < sz);
+}
+
+static void dcache_evict_cb(const void *key, size_t klen,
+			    const void *val, size_t vlen,
+			    void *private)
+{
+	pyglfs_dcache_t *dc = (pyglfs_dcache_t *)private;
+	char path[PATH_MAX];
+
+	if (dcache_path(dc, key, val, path, sizeof(path))) {
+		unlink(path);
+	}
+}
+
+/*
+ * Rebuild index from cache directory. Leftover temporary files from
+ * interrupted fills are removed.
+ */
+static void dcache_scan(pyglfs_dcache_t *dc)
+{
+	DIR *dirp = NULL;
+	struct dirent *de = NULL;
+
+	dirp = opendir(dc->dir);
+	if (dirp == NULL) {
+		return;
+	}
+
+	while ((de = readdir(dirp)) != NULL) {
+		char uuid_str[37], path[PATH_MAX];
+		dcache_ver_t ver;
+		struct stat st;
+		uuid_t gfid;
+		long size, mtime, ctime;
+		int n;
+
+		if (strncmp(de->d_name, DCACHE_TMP_PREFIX,
+			    strlen(DCACHE_TMP_PREFIX)) == 0) {
+			n = snprintf(path, sizeof(path), "%s/%s", dc->dir,
+				     de->d_name);
+			if ((n >= 0) && ((size_t)n < sizeof(path))) {
+				unlink(path);
+			}
+			continue;
+		}
+
+		if ((sscanf(de->d_name, "%36[0-9a-f-].%ld.%ld.%ld",
+			    uuid_str, &size, &mtime, &ctime) != 4) ||
+		    (uuid_parse(uuid_str, gfid) != 0)) {
+			continue;
+		}
+
+		ver = (dcache_ver_t) {
+			.size = size,
+			.mtime_ns = mtime,
+			.ctime_ns = ctime,
+		};
+
+		if (!dcache_path(dc, gfid, &ver, path, sizeof(path))) {
+			continue;
+		}
+
+		if ((stat(path, &st) == -1) || (st.st_size != size)) {
+			/* truncated or renamed by someone else */
+			unlink(path);
+			continue;
+		}
+
+		/* replaced versions and entries over the limit are removed */
+		if (!pyglfs_cache_put_cost(dc->index, gfid, sizeof(uuid_t),
+					   &ver, sizeof(ver), size)) {
+			unlink(path);
+		}
+	}
+
+	closedir(dirp);
+}
+
+pyglfs_dcache_t *pyglfs_dcache_new(const char *dir, size_t max_bytes)
+{
+	pyglfs_dcache_t *dc = NULL;
+	struct stat st;
+
+	if (strlen(dir) >= sizeof(dc->dir) - 64) {
+		PyErr_Format(PyExc_ValueError, "%s: path too long.", dir);
+		return NULL;
+	}
+
+	if (stat(dir, &st) == -1) {
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, dir);
+		return NULL;
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		errno = ENOTDIR;
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, dir);
+		return NULL;
+	}
+
+	dc = calloc(1, sizeof(pyglfs_dcache_t));
+	if (dc == NULL) {
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	strlcpy(dc->dir, dir, sizeof(dc->dir));
+
+	/* entries never expire. validity is checked against stat */
+	dc->index = pyglfs_cache_new(PYGLFS_DEFAULT_CACHE_ENTRIES, 0);
+	if (dc->index == NULL) {
+		free(dc);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	pyglfs_cache_set_max_bytes(dc->index, max_bytes);
+	pyglfs_cache_set_evict_cb(dc->index, dcache_evict_cb, dc);
+
+	Py_BEGIN_ALLOW_THREADS
+	dcache_scan(dc);
+	Py_END_ALLOW_THREADS
+
+	return dc;
+}
+
+/*
+ * Free in-memory state. Cached files are kept for later use.
+ */
+void pyglfs_dcache_free(pyglfs_dcache_t *dc)
+{
+	if (dc == NULL) {
+		return;
+	}
+
+	pyglfs_cache_free(dc->index);
+	free(dc);
+}
+
+/*
+ * Open local copy of file if it matches stat of the remote file.
+ * Returns -1 if there is no valid copy.
+ */
+static int dcache_open(pyglfs_dcache_t *dc,
+		       const unsigned char *gfid,
+		       const dcache_ver_t *ver)
+{
+	dcache_ver_t cached;
+	char path[PATH_MAX];
+	int fd = -1;
+
+	if (!pyglfs_cache_get(dc->index, gfid, sizeof(uuid_t),
+			      &cached, sizeof(cached))) {
+		return -1;
+	}
+
+	if (memcmp(&cached, ver, sizeof(cached)) != 0) {
+		/* remote file changed. drop stale copy */
+		pyglfs_cache_remove(dc->index, gfid, sizeof(uuid_t));
+		return -1;
+	}
+
+	if (dcache_path(dc, gfid, ver, path, sizeof(path))) {
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+	}
+	if (fd == -1) {
+		pyglfs_cache_remove(dc->index, gfid, sizeof(uuid_t));
+	}
+
+	return fd;
+}
+
+static pyglfs_dcache_fill_t *dcache_fill_start(pyglfs_dcache_t *dc,
+					       const unsigned char *gfid,
+					       const dcache_ver_t *ver)
+{
+	pyglfs_dcache_fill_t *fill = NULL;
+	int n;
+
+	fill = calloc(1, sizeof(pyglfs_dcache_fill_t));
+	if (fill == NULL) {
+		return NULL;
+	}
+
+	n = snprintf(fill->path, sizeof(fill->path),
+		     "%s/" DCACHE_TMP_PREFIX "XXXXXX", dc->dir);
+	if ((n < 0) || ((size_t)n >= sizeof(fill->path))) {
+		free(fill);
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	fill->fd = mkostemp(fill->path, O_CLOEXEC);
+	if (fill->fd == -1) {
+		free(fill);
+		return NULL;
+	}
+
+	pthread_mutex_init(&fill->lock, NULL);
+	memcpy(fill->gfid, gfid, sizeof(uuid_t));
+	fill->ver = *ver;
+	return fill;
+}
+
+static void dcache_fill_free(pyglfs_dcache_fill_t *fill, bool keep)
+{
+	if (fill->fd != -1) {
+		close(fill->fd);
+		fill->fd = -1;
+	}
+
+	if (!keep) {
+		unlink(fill->path);
+	}
+}
+
+/*
+ * Check the disk cache for read-only FD on regular file. Sets up either
+ * local file to serve reads from or fill of the cache. Failures only
+ * disable caching for the FD.
+ */
+void pyglfs_dcache_attach(py_glfs_fd_t *fd)
+{
+	pyglfs_dcache_t *dc = fd->parent->py_fs->disk_cache;
+	dcache_ver_t ver;
+	struct stat st;
+	int err;
+
+	if ((dc == NULL) || ((fd->flags & O_ACCMODE) != O_RDONLY) ||
+	    (fd->flags & O_DIRECTORY)) {
+		return;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	err = glfs_h_stat(fd->parent->py_fs->fs, fd->parent->gl_obj, &st);
+	if ((err == 0) && S_ISREG(st.st_mode)) {
+		dcache_ver_from_stat(&ver, &st);
+		fd->dc_fd = dcache_open(dc, fd->parent->gfid, &ver);
+		if ((fd->dc_fd == -1) && (st.st_size > 0)) {
+			fd->dc_fill = dcache_fill_start(dc, fd->parent->gfid,
+							&ver);
+		}
+	}
+	Py_END_ALLOW_THREADS
+}
+
+/*
+ * Append data read from the remote file at offset to fill of the cache.
+ * Non-sequential reads abandon the fill. Called without the GIL.
+ */
+void pyglfs_dcache_fill(py_glfs_fd_t *fd, const char *buf,
+			size_t cnt, ssize_t n, off_t offset)
+{
+	pyglfs_dcache_t *dc = fd->parent->py_fs->disk_cache;
+	pyglfs_dcache_fill_t *fill = fd->dc_fill;
+	bool done = false, keep = false;
+
+	if ((fill == NULL) || (n < 0)) {
+		return;
+	}
+
+	if (pthread_mutex_trylock(&fill->lock) != 0) {
+		/* concurrent read on FD. next read will be out of sequence */
+		return;
+	}
+
+	if ((fill->fd == -1) || (offset != fill->pos)) {
+		done = true;
+	} else if ((n > 0) && (pwrite(fill->fd, buf, n, offset) != n)) {
+		done = true;
+	} else {
+		fill->pos += n;
+		if ((fill->pos >= fill->ver.size) || ((size_t)n < cnt)) {
+			done = true;
+			keep = (fill->pos == fill->ver.size);
+		}
+	}
+
+	if (done && (fill->fd != -1)) {
+		char path[PATH_MAX];
+
+		if (keep) {
+			keep = dcache_path(dc, fill->gfid, &fill->ver,
+					   path, sizeof(path)) &&
+			    (fsync(fill->fd) == 0) &&
+			    (rename(fill->path, path) == 0);
+		}
+
+		dcache_fill_free(fill, keep);
+		if (keep && !pyglfs_cache_put_cost(dc->index, fill->gfid,
+						   sizeof(uuid_t), &fill->ver,
+						   sizeof(fill->ver),
+						   fill->ver.size)) {
+			/* larger than the whole cache */
+			unlink(path);
+		}
+	}
+	pthread_mutex_unlock(&fill->lock);
+}
+
+/*
+ * Release disk cache state of FD. Incomplete fill is discarded.
+ */
+void pyglfs_dcache_detach(py_glfs_fd_t *fd)
+{
+	if (fd->dc_fd != -1) {
+		close(fd->dc_fd);
+		fd->dc_fd = -1;
+	}
+
+	if (fd->dc_fill != NULL) {
+		dcache_fill_free(fd->dc_fill, false);
+		pthread_mutex_destroy(&fd->dc_fill->lock);
+		free(fd->dc_fill);
+		fd->dc_fill = NULL;
+	}
+}
+
+PyObject *pyglfs_dcache_stats_to_dict(pyglfs_dcache_t *dc)
+{
+	if (dc == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	return pyglfs_cache_stats_to_dict(dc->index);
+}
@@ -0,0 +1,829 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <Python.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Directory listing.
+ *
+ * Names are packed into a single byte arena with an array of offsets
+ * rather than fixed size slots, and both grow geometrically, so memory
+ * use is proportional to the total length of names in the directory.
+ */
+
+#define NAMES_INITIAL_BYTES	4096
+#define NAMES_INITIAL_CNT	64
+#define DIR_STREAM_BATCH	1024
+
+typedef struct {
+	char *buf;
+	size_t len;
+	size_t alloc;
+	size_t *offs;
+	size_t cnt;
+	size_t offs_alloc;
+} names_t;
+
+static inline const char *names_get(const names_t *names, size_t idx)
+{
+	return names->buf + names->offs[idx];
+}
+
+static void names_init(names_t *names)
+{
+	*names = (names_t) { .buf = NULL };
+}
+
+static void names_free(names_t *names)
+{
+	free(names->buf);
+	free(names->offs);
+	names_init(names);
+}
+
+/* keep allocations but drop names */
+static void names_reset(names_t *names)
+{
+	names->len = 0;
+	names->cnt = 0;
+}
+
+static bool names_add(names_t *names, const char *name)
+{
+	size_t sz = strlen(name) + 1;
+
+	if (names->len + sz > names->alloc) {
+		size_t alloc = names->alloc ? names->alloc : NAMES_INITIAL_BYTES;
+		char *buf = NULL;
+
+		while (names->len + sz > alloc) {
+			alloc *= 2;
+		}
+
+		buf = realloc(names->buf, alloc);
+		if (buf == NULL) {
+			return false;
+		}
+		names->buf = buf;
+		names->alloc = alloc;
+	}
+
+	if (names->cnt == names->offs_alloc) {
+		size_t alloc = names->offs_alloc ? names->offs_alloc * 2 :
+		    NAMES_INITIAL_CNT;
+		size_t *offs = NULL;
+
+		offs = realloc(names->offs, alloc * sizeof(size_t));
+		if (offs == NULL) {
+			return false;
+		}
+		names->offs = offs;
+		names->offs_alloc = alloc;
+	}
+
+	memcpy(names->buf + names->len, name, sz);
+	names->offs[names->cnt++] = names->len;
+	names->len += sz;
+	return true;
+}
+
+/*
+ * Read up to max entries (0 for no limit) from directory fd into names,
+ * skipping "." and "..". Sets eof when the end of the directory is
+ * reached. Called without the GIL. Returns false with errno set on
+ * failure.
+ */
+static bool read_dir_batch(glfs_fd_t *fd, names_t *names,
+			   size_t max, bool *eof)
+{
+	struct dirent de, *result = NULL;
+	size_t cnt = 0;
+
+	*eof = false;
+
+	while ((max == 0) || (cnt < max)) {
+		if (glfs_readdir_r(fd, &de, &result) != 0) {
+			return false;
+		}
+
+		if (result == NULL) {
+			*eof = true;
+			break;
+		}
+
+		if ((strcmp(result->d_name, ".") == 0) ||
+		    (strcmp(result->d_name, "..") == 0)) {
+			continue;
+		}
+
+		if (!names_add(names, result->d_name)) {
+			errno = ENOMEM;
+			return false;
+		}
+		cnt++;
+	}
+
+	return true;
+}
+
+static PyObject *names_to_pylist(const names_t *names)
+{
+	PyObject *out = NULL;
+	size_t i;
+
+	out = PyList_New(names->cnt);
+	if (out == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < names->cnt; i++) {
+		PyObject *name = PyUnicode_FromString(names_get(names, i));
+		if (name == NULL) {
+			Py_DECREF(out);
+			return NULL;
+		}
+		PyList_SET_ITEM(out, i, name);
+	}
+
+	return out;
+}
+
+/*
+ * Iterator over names in a directory that reads entries in batches
+ * without materialising the whole listing.
+ */
+typedef struct {
+	PyObject_HEAD
+	py_glfs_obj_t *parent;
+	glfs_fd_t *fd;
+	names_t batch;
+	size_t pos;
+	bool eof;
+} py_glfs_dir_stream_t;
+
+static void dir_stream_close(py_glfs_dir_stream_t *self)
+{
+	if (self->fd != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		glfs_closedir(self->fd);
+		Py_END_ALLOW_THREADS
+		self->fd = NULL;
+	}
+}
+
+static void py_glfs_dir_stream_dealloc(py_glfs_dir_stream_t *self)
+{
+	dir_stream_close(self);
+	names_free(&self->batch);
+	Py_CLEAR(self->parent);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *py_glfs_dir_stream_next(py_glfs_dir_stream_t *self)
+{
+	bool ok;
+
+	if (self->pos == self->batch.cnt) {
+		if (self->eof || (self->fd == NULL)) {
+			return NULL;
+		}
+
+		names_reset(&self->batch);
+		self->pos = 0;
+
+		Py_BEGIN_ALLOW_THREADS
+		ok = read_dir_batch(self->fd, &self->batch,
+				    DIR_STREAM_BATCH, &self->eof);
+		Py_END_ALLOW_THREADS
+
+		if (!ok) {
+			set_glfs_exc("glfs_readdir_r()");
+			dir_stream_close(self);
+			return NULL;
+		}
+
+		if (self->eof) {
+			dir_stream_close(self);
+		}
+
+		if (self->batch.cnt == 0) {
+			return NULL;
+		}
+	}
+
+	return PyUnicode_FromString(names_get(&self->batch, self->pos++));
+}
+
+PyTypeObject PyGlfsDirStream = {
+	.tp_name = "pyglfs.DirStream",
+	.tp_basicsize = sizeof(py_glfs_dir_stream_t),
+	.tp_doc = "Iterator over names of entries in a glusterfs directory",
+	.tp_dealloc = (destructor)py_glfs_dir_stream_dealloc,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)py_glfs_dir_stream_next,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+static glfs_fd_t *open_dir(py_glfs_obj_t *hdl)
+{
+	glfs_fd_t *fd = NULL;
+
+	Py_BEGIN_ALLOW_THREADS
+	fd = glfs_h_opendir(hdl->py_fs->fs, hdl->gl_obj);
+	Py_END_ALLOW_THREADS
+
+	if (fd == NULL) {
+		set_glfs_exc("glfs_h_opendir()");
+	}
+
+	return fd;
+}
+
+PyObject *init_glfs_dir_stream(py_glfs_obj_t *hdl)
+{
+	py_glfs_dir_stream_t *self = NULL;
+	glfs_fd_t *fd = NULL;
+
+	fd = open_dir(hdl);
+	if (fd == NULL) {
+		return NULL;
+	}
+
+	self = PyObject_New(py_glfs_dir_stream_t, &PyGlfsDirStream);
+	if (self == NULL) {
+		glfs_closedir(fd);
+		return NULL;
+	}
+
+	self->parent = hdl;
+	Py_INCREF(hdl);
+	self->fd = fd;
+	names_init(&self->batch);
+	self->pos = 0;
+	self->eof = false;
+
+	return (PyObject *)self;
+}
+
+PyObject *pyglfs_dir_listing(py_glfs_obj_t *hdl)
+{
+	PyObject *out = NULL;
+	names_t names;
+	glfs_fd_t *fd = NULL;
+	bool ok, eof;
+	int err;
+
+	fd = open_dir(hdl);
+	if (fd == NULL) {
+		return NULL;
+	}
+
+	names_init(&names);
+
+	Py_BEGIN_ALLOW_THREADS
+	ok = read_dir_batch(fd, &names, 0, &eof);
+	err = errno;
+	glfs_closedir(fd);
+	Py_END_ALLOW_THREADS
+
+	if (!ok) {
+		/* closedir may have clobbered errno of the failed read */
+		errno = err;
+		set_glfs_exc("glfs_readdir_r()");
+		names_free(&names);
+		return NULL;
+	}
+
+	out = names_to_pylist(&names);
+	names_free(&names);
+	return out;
+}
+
+/*
+ * scandir()
+ *
+ * Entries are read with glfs_xreaddirplus_r() in batches with the GIL
+ * released. Each DirEntry keeps d_type, gfid and (optionally) stat from
+ * the readdirplus reply, so that callers do not need a lookup per entry.
+ * The ObjectHandle is only created when handle() is called, from the
+ * gfid, which does not require an RPC while the inode is still cached
+ * by gfapi. Results also feed the attribute and dentry caches.
+ */
+
+#define SCANDIR_BATCH	256
+
+typedef struct {
+	unsigned char d_type;
+	bool has_gfid;
+	uuid_t gfid;
+	pyglfs_stat_t st;
+} scandir_rec_t;
+
+typedef struct {
+	PyObject_HEAD
+	py_glfs_obj_t *parent;
+	PyObject *name;
+	unsigned char d_type;
+	bool has_gfid;
+	uuid_t gfid;
+	pyglfs_stat_t st;
+	PyObject *pystat;
+	PyObject *handle;
+} py_glfs_dirent_t;
+
+typedef struct {
+	PyObject_HEAD
+	py_glfs_obj_t *parent;
+	glfs_fd_t *fd;
+	bool do_stat;
+	names_t names;
+	scandir_rec_t recs[SCANDIR_BATCH];
+	size_t pos;
+	bool eof;
+} py_glfs_scandir_t;
+
+static void py_glfs_dirent_dealloc(py_glfs_dirent_t *self)
+{
+	Py_CLEAR(self->parent);
+	Py_CLEAR(self->name);
+	Py_CLEAR(self->pystat);
+	Py_CLEAR(self->handle);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static mode_t dirent_type_mode(py_glfs_dirent_t *self)
+{
+	if (self->d_type != DT_UNKNOWN) {
+		return DTTOIF(self->d_type);
+	}
+
+	return self->st.valid ? (self->st.st_mode & S_IFMT) : 0;
+}
+
+PyDoc_STRVAR(py_glfs_dirent_is_dir__doc__,
+"is_dir()\n"
+"--\n\n"
+"Return True if the entry is a directory. Symlinks are not followed.\n"
+"Does not require an RPC.\n"
+);
+
+static PyObject *py_glfs_dirent_is_dir(PyObject *obj, PyObject *args_unused)
+{
+	return PyBool_FromLong(S_ISDIR(dirent_type_mode((py_glfs_dirent_t *)obj)));
+}
+
+PyDoc_STRVAR(py_glfs_dirent_is_file__doc__,
+"is_file()\n"
+"--\n\n"
+"Return True if the entry is a regular file. Symlinks are not followed.\n"
+"Does not require an RPC.\n"
+);
+
+static PyObject *py_glfs_dirent_is_file(PyObject *obj, PyObject *args_unused)
+{
+	return PyBool_FromLong(S_ISREG(dirent_type_mode((py_glfs_dirent_t *)obj)));
+}
+
+PyDoc_STRVAR(py_glfs_dirent_is_symlink__doc__,
+"is_symlink()\n"
+"--\n\n"
+"Return True if the entry is a symbolic link. Does not require an RPC.\n"
+);
+
+static PyObject *py_glfs_dirent_is_symlink(PyObject *obj, PyObject *args_unused)
+{
+	return PyBool_FromLong(S_ISLNK(dirent_type_mode((py_glfs_dirent_t *)obj)));
+}
+
+PyDoc_STRVAR(py_glfs_dirent_handle__doc__,
+"handle()\n"
+"--\n\n"
+"Return pyglfs.ObjectHandle for the entry. The handle is created on\n"
+"first call and reused afterwards.\n\n"
+"Returns\n"
+"-------\n"
+"handle : glfs.ObjectHandle\n"
+);
+
+static PyObject *py_glfs_dirent_handle(PyObject *obj, PyObject *args_unused)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+	py_glfs_t *py_fs = self->parent->py_fs;
+	glfs_object_t *gl_obj = NULL;
+	const char *name = NULL;
+	bool looked_up = false;
+	struct stat st;
+
+	if (self->handle != NULL) {
+		Py_INCREF(self->handle);
+		return self->handle;
+	}
+
+	name = PyUnicode_AsUTF8(self->name);
+	if (name == NULL) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	if (self->has_gfid) {
+		gl_obj = glfs_h_create_from_handle(py_fs->fs, self->gfid,
+						   sizeof(uuid_t), NULL);
+	}
+	if (gl_obj == NULL) {
+		/* handle not returned by readdirplus, or stale */
+		gl_obj = glfs_h_lookupat(py_fs->fs, self->parent->gl_obj,
+					 name, &st, false);
+		looked_up = true;
+	}
+	Py_END_ALLOW_THREADS
+
+	if (gl_obj == NULL) {
+		set_glfs_exc("glfs_h_lookupat()");
+		return NULL;
+	}
+
+	if (looked_up) {
+		pyglfs_stat_pack(&self->st, &st);
+		Py_CLEAR(self->pystat);
+	} else if (self->st.valid) {
+		pyglfs_stat_unpack(&self->st, &st);
+	}
+
+	self->handle = init_glfs_object(py_fs, gl_obj,
+					self->st.valid ? &st : NULL, name);
+	if (self->handle == NULL) {
+		glfs_h_close(gl_obj);
+		return NULL;
+	}
+
+	Py_INCREF(self->handle);
+	return self->handle;
+}
+
+PyDoc_STRVAR(py_glfs_dirent_stat__doc__,
+"stat()\n"
+"--\n\n"
+"Return stat_result for the entry. If scandir() was called with\n"
+"stat=True this is the stat returned by readdirplus and does not\n"
+"require an RPC. Otherwise the entry is looked up on first call.\n"
+"Symlinks are not followed.\n\n"
+"Returns\n"
+"-------\n"
+"stat_result\n"
+);
+
+static PyObject *py_glfs_dirent_stat(PyObject *obj, PyObject *args_unused)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+
+	if (!self->st.valid) {
+		PyObject *hdl = py_glfs_dirent_handle(obj, NULL);
+		if (hdl == NULL) {
+			return NULL;
+		}
+		Py_DECREF(hdl);
+
+		if (!self->st.valid) {
+			return PyObject_CallMethod(self->handle, "stat", NULL);
+		}
+	}
+
+	if (self->pystat == NULL) {
+		self->pystat = compact_stat_to_pystat(&self->st);
+		if (self->pystat == NULL) {
+			return NULL;
+		}
+	}
+
+	Py_INCREF(self->pystat);
+	return self->pystat;
+}
+
+PyDoc_STRVAR(py_glfs_dirent_inode__doc__,
+"inode()\n"
+"--\n\n"
+"Return inode number of the entry.\n"
+);
+
+static PyObject *py_glfs_dirent_inode(PyObject *obj, PyObject *args_unused)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+	PyObject *st = NULL, *ino = NULL;
+
+	if (self->st.valid) {
+		return PyLong_FromUnsignedLongLong(self->st.st_ino);
+	}
+
+	st = py_glfs_dirent_stat(obj, NULL);
+	if (st == NULL) {
+		return NULL;
+	}
+
+	ino = PyObject_GetAttrString(st, "st_ino");
+	Py_DECREF(st);
+	return ino;
+}
+
+static PyObject *py_glfs_dirent_get_name(PyObject *obj, void *closure)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+
+	Py_INCREF(self->name);
+	return self->name;
+}
+
+static PyObject *py_glfs_dirent_get_uuid(PyObject *obj, void *closure)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+	char uuid_str[37];
+
+	if (!self->has_gfid) {
+		Py_RETURN_NONE;
+	}
+
+	uuid_unparse(self->gfid, uuid_str);
+	return PyUnicode_FromString(uuid_str);
+}
+
+static PyObject *py_glfs_dirent_repr(PyObject *obj)
+{
+	py_glfs_dirent_t *self = (py_glfs_dirent_t *)obj;
+
+	return PyUnicode_FromFormat("<pyglfs.DirEntry %R>", self->name);
+}
+
+static PyMethodDef py_glfs_dirent_methods[] = {
+	{
+		.ml_name = "is_dir",
+		.ml_meth = (PyCFunction)py_glfs_dirent_is_dir,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_is_dir__doc__
+	},
+	{
+		.ml_name = "is_file",
+		.ml_meth = (PyCFunction)py_glfs_dirent_is_file,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_is_file__doc__
+	},
+	{
+		.ml_name = "is_symlink",
+		.ml_meth = (PyCFunction)py_glfs_dirent_is_symlink,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_is_symlink__doc__
+	},
+	{
+		.ml_name = "stat",
+		.ml_meth = (PyCFunction)py_glfs_dirent_stat,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_stat__doc__
+	},
+	{
+		.ml_name = "inode",
+		.ml_meth = (PyCFunction)py_glfs_dirent_inode,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_inode__doc__
+	},
+	{
+		.ml_name = "handle",
+		.ml_meth = (PyCFunction)py_glfs_dirent_handle,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_dirent_handle__doc__
+	},
+	{ NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef py_glfs_dirent_getsetters[] = {
+	{
+		.name    = discard_const_p(char, "name"),
+		.get     = (getter)py_glfs_dirent_get_name,
+		.doc     = "Name of the entry in its directory.",
+	},
+	{
+		.name    = discard_const_p(char, "uuid"),
+		.get     = (getter)py_glfs_dirent_get_uuid,
+		.doc     = "UUID (gfid) of the entry, or None if not returned by "
+			   "the server.",
+	},
+	{ .name = NULL }
+};
+
+PyTypeObject PyGlfsDirEntry = {
+	.tp_name = "pyglfs.DirEntry",
+	.tp_basicsize = sizeof(py_glfs_dirent_t),
+	.tp_methods = py_glfs_dirent_methods,
+	.tp_getset = py_glfs_dirent_getsetters,
+	.tp_repr = py_glfs_dirent_repr,
+	.tp_doc = "Directory entry returned by ObjectHandle.scandir()",
+	.tp_dealloc = (destructor)py_glfs_dirent_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+/*
+ * Read next batch of entries. Called without the GIL.
+ */
+static bool scandir_read_batch(py_glfs_scandir_t *self)
+{
+	py_glfs_t *py_fs = self->parent->py_fs;
+	uint32_t flags = GFAPI_XREADDIRP_HANDLE;
+	struct dirent de, *result = NULL;
+
+	if (self->do_stat) {
+		flags |= GFAPI_XREADDIRP_STAT;
+	}
+
+	names_reset(&self->names);
+
+	while (self->names.cnt < SCANDIR_BATCH) {
+		glfs_xreaddirp_stat_t *xstat = NULL;
+		scandir_rec_t *rec = &self->recs[self->names.cnt];
+		glfs_object_t *obj = NULL;
+		struct stat *st = NULL;
+
+		if (glfs_xreaddirplus_r(self->fd, flags, &xstat,
+					&de, &result) == -1) {
+			return false;
+		}
+
+		if (result == NULL) {
+			self->eof = true;
+			break;
+		}
+
+		if ((strcmp(result->d_name, ".") == 0) ||
+		    (strcmp(result->d_name, "..") == 0)) {
+			glfs_free(xstat);
+			continue;
+		}
+
+		if (!names_add(&self->names, result->d_name)) {
+			glfs_free(xstat);
+			errno = ENOMEM;
+			return false;
+		}
+
+		*rec = (scandir_rec_t) { .d_type = result->d_type };
+
+		if (xstat != NULL) {
+			obj = glfs_xreaddirplus_get_object(xstat);
+			st = glfs_xreaddirplus_get_stat(xstat);
+		}
+
+		if ((obj != NULL) &&
+		    (glfs_h_extract_handle(obj, rec->gfid, sizeof(uuid_t)) != -1)) {
+			rec->has_gfid = true;
+		}
+
+		/* path resolution must not skip over symlinks */
+		if (rec->has_gfid && (result->d_type != DT_LNK) &&
+		    ((st == NULL) || !S_ISLNK(st->st_mode))) {
+			pyglfs_dentry_cache_put(py_fs, self->parent->gfid,
+						result->d_name,
+						strlen(result->d_name),
+						rec->gfid);
+		}
+
+		if (st != NULL) {
+			pyglfs_stat_pack(&rec->st, st);
+			if (rec->has_gfid) {
+				pyglfs_attr_cache_put(py_fs, rec->gfid, st);
+			}
+		}
+
+		glfs_free(xstat);
+	}
+
+	return true;
+}
+
+static void scandir_close(py_glfs_scandir_t *self)
+{
+	if (self->fd != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		glfs_closedir(self->fd);
+		Py_END_ALLOW_THREADS
+		self->fd = NULL;
+	}
+}
+
+static void py_glfs_scandir_dealloc(py_glfs_scandir_t *self)
+{
+	scandir_close(self);
+	names_free(&self->names);
+	Py_CLEAR(self->parent);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *py_glfs_scandir_next(py_glfs_scandir_t *self)
+{
+	py_glfs_dirent_t *entry = NULL;
+	scandir_rec_t *rec = NULL;
+	bool ok;
+
+	if (self->pos == self->names.cnt) {
+		if (self->eof || (self->fd == NULL)) {
+			return NULL;
+		}
+
+		self->pos = 0;
+
+		Py_BEGIN_ALLOW_THREADS
+		ok = scandir_read_batch(self);
+		Py_END_ALLOW_THREADS
+
+		if (!ok) {
+			set_glfs_exc("glfs_xreaddirplus_r()");
+			names_reset(&self->names);
+			scandir_close(self);
+			return NULL;
+		}
+
+		if (self->eof) {
+			scandir_close(self);
+		}
+
+		if (self->names.cnt == 0) {
+			return NULL;
+		}
+	}
+
+	entry = PyObject_New(py_glfs_dirent_t, &PyGlfsDirEntry);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	rec = &self->recs[self->pos];
+	entry->name = PyUnicode_FromString(names_get(&self->names, self->pos));
+	self->pos++;
+
+	entry->parent = self->parent;
+	Py_INCREF(entry->parent);
+	entry->d_type = rec->d_type;
+	entry->has_gfid = rec->has_gfid;
+	memcpy(entry->gfid, rec->gfid, sizeof(uuid_t));
+	entry->st = rec->st;
+	entry->pystat = NULL;
+	entry->handle = NULL;
+
+	if (entry->name == NULL) {
+		Py_DECREF(entry);
+		return NULL;
+	}
+
+	return (PyObject *)entry;
+}
+
+PyTypeObject PyGlfsScandirIterator = {
+	.tp_name = "pyglfs.ScandirIterator",
+	.tp_basicsize = sizeof(py_glfs_scandir_t),
+	.tp_doc = "Iterator of pyglfs.DirEntry objects for a directory",
+	.tp_dealloc = (destructor)py_glfs_scandir_dealloc,
+	.tp_iter = PyObject_SelfIter,
+	.tp_iternext = (iternextfunc)py_glfs_scandir_next,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+PyObject *init_glfs_scandir(py_glfs_obj_t *hdl, bool do_stat)
+{
+	py_glfs_scandir_t *self = NULL;
+	glfs_fd_t *fd = NULL;
+
+	fd = open_dir(hdl);
+	if (fd == NULL) {
+		return NULL;
+	}
+
+	self = PyObject_New(py_glfs_scandir_t, &PyGlfsScandirIterator);
+	if (self == NULL) {
+		glfs_closedir(fd);
+		return NULL;
+	}
+
+	self->parent = hdl;
+	Py_INCREF(hdl);
+	self->fd = fd;
+	self->do_stat = do_stat;
+	names_init(&self->names);
+	self->pos = 0;
+	self->eof = false;
+
+	return (PyObject *)self;
+}
@@ -18,6 +18,7 @@
  */
 
 #include <Python.h>
+#include <unistd.h>
 #include "includes.h"
 #include "pyglfs.h"
 
@@ -31,6 +32,7 @@ static PyObject *py_glfs_fd_new(PyTypeObject *obj,
 	if (self == NULL) {
 		return NULL;
 	}
+	self->dc_fd = -1;
 	return (PyObject *)self;
 }
 
@@ -43,6 +45,25 @@ static int py_glfs_fd_init(PyObject *obj,
 
 void py_glfs_fd_dealloc(py_glfs_fd_t *self)
 {
+	/* lease must be released before fd is closed */
+	pyglfs_lease_cache_free(self->lease_cache);
+	self->lease_cache = NULL;
+	pyglfs_dcache_detach(self);
+
+	if (self->fd && self->poolable) {
+		bool pooled;
+
+		/* may close a displaced idle fd */
+		Py_BEGIN_ALLOW_THREADS
+		pooled = pyglfs_fdpool_put(self->parent->py_fs,
+					   self->parent->gfid,
+					   self->flags, self->fd);
+		Py_END_ALLOW_THREADS
+		if (pooled) {
+			self->fd = NULL;
+		}
+	}
+
 	if (self->fd) {
 		int rv;
 		if (self->flags & O_DIRECTORY) {
@@ -75,9 +96,67 @@ PyObject *init_glfs_fd(glfs_fd_t *fd_in, py_glfs_obj_t *hdl, int flags)
 	pyfd->parent = hdl;
 	Py_INCREF(hdl);
 
+	pyglfs_dcache_attach(pyfd);
 	return (PyObject *)pyfd;
 }
 
+/*
+ * Report failure of glfs call on the fd. If errno mode is enabled
+ * the errno is returned to caller as an int instead of raising
+ * GLFSError, which saves constructing exceptions for expected
+ * failures such as lock contention or missing xattrs.
+ */
+static PyObject *fd_fail(py_glfs_fd_t *self, const char *location)
+{
+	if (self->errno_mode) {
+		return PyLong_FromLong(errno);
+	}
+
+	set_glfs_exc(location);
+	return NULL;
+}
+
+static void fd_set_stat(py_glfs_fd_t *self, const struct stat *st)
+{
+	pyglfs_stat_pack(&self->last_st, st);
+	pyglfs_obj_set_stat(self->parent, st);
+	pyglfs_attr_cache_put(self->parent->py_fs, self->parent->gfid, st);
+}
+
+/*
+ * Record post-op attributes returned by a fop on the FD. These also
+ * refresh the stat of the parent handle and the attribute cache, so
+ * that callers do not need a separate fstat() to see the new size and
+ * times. Attributes that are incomplete are ignored.
+ */
+static void fd_set_poststat(py_glfs_fd_t *self, const struct glfs_stat *gst)
+{
+	struct stat st;
+
+	if ((gst->glfs_st_mask & GLFS_STAT_BASIC_STATS) != GLFS_STAT_BASIC_STATS) {
+		pyglfs_attr_cache_invalidate(self->parent->py_fs,
+					     self->parent->gfid);
+		return;
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.st_ino = gst->glfs_st_ino;
+	st.st_dev = gst->glfs_st_dev;
+	st.st_rdev = gst->glfs_st_rdev;
+	st.st_size = gst->glfs_st_size;
+	st.st_nlink = gst->glfs_st_nlink;
+	st.st_uid = gst->glfs_st_uid;
+	st.st_gid = gst->glfs_st_gid;
+	st.st_mode = gst->glfs_st_mode;
+	st.st_blksize = gst->glfs_st_blksize;
+	st.st_blocks = gst->glfs_st_blocks;
+	st.st_atim = gst->glfs_st_atime;
+	st.st_mtim = gst->glfs_st_mtime;
+	st.st_ctim = gst->glfs_st_ctime;
+
+	fd_set_stat(self, &st);
+}
+
 PyDoc_STRVAR(py_glfs_fd_fstat__doc__,
 "fstat()\n"
 "--\n\n"
@@ -103,10 +182,10 @@ static PyObject *py_glfs_fd_fstat(PyObject *obj,
 	Py_END_ALLOW_THREADS
 
 	if (err) {
-		set_glfs_exc("glfs_fstat()");
-		return NULL;
+		return fd_fail(self, "glfs_fstat()");
 	}
 
+	fd_set_stat(self, &st);
 	return stat_to_pystat(&st);
 }
 
@@ -128,17 +207,19 @@ static PyObject *py_glfs_fd_fsync(PyObject *obj,
 				  PyObject *kwargs_unused)
 {
 	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+	struct glfs_stat post = { .glfs_st_mask = 0 };
 	int err;
 
 	Py_BEGIN_ALLOW_THREADS
-	err = glfs_fsync(self->fd, NULL, NULL);
+	err = glfs_fsync(self->fd, NULL, &post);
 	Py_END_ALLOW_THREADS
 
 	if (err) {
-		set_glfs_exc("glfs_fsync()");
-		return NULL;
+		return fd_fail(self, "glfs_fsync()");
 	}
 
+	fd_set_poststat(self, &post);
+
 	Py_RETURN_NONE;
 }
 
@@ -205,6 +286,8 @@ static PyObject *py_glfs_fd_fchmod(PyObject *obj,
 	err = glfs_fchmod(self->fd, mode);
 	Py_END_ALLOW_THREADS
 
+	pyglfs_attr_cache_invalidate(self->parent->py_fs, self->parent->gfid);
+
 	if (err) {
 		set_glfs_exc("glfs_fchmod()");
 		return NULL;
@@ -246,6 +329,8 @@ static PyObject *py_glfs_fd_fchown(PyObject *obj,
 	err = glfs_fchown(self->fd, (uid_t)uid, (gid_t)gid);
 	Py_END_ALLOW_THREADS
 
+	pyglfs_attr_cache_invalidate(self->parent->py_fs, self->parent->gfid);
+
 	if (err) {
 		set_glfs_exc("glfs_fchown()");
 		return NULL;
@@ -268,11 +353,38 @@ PyDoc_STRVAR(py_glfs_fd_ftruncate__doc__,
 "None\n"
 );
 
+/*
+ * Drop cached blocks overlapping `len` bytes at `start` and the block
+ * holding the EOF before the fop, as reported by its pre-op attributes.
+ * All blocks of the file are dropped if the pre-op size is unknown.
+ */
+static void fd_bcache_invalidate(py_glfs_fd_t *self,
+				 const struct glfs_stat *pre,
+				 uint64_t start,
+				 uint64_t len)
+{
+	py_glfs_t *py_fs = self->parent->py_fs;
+
+	if (!(pre->glfs_st_mask & GLFS_STAT_SIZE)) {
+		pyglfs_bcache_invalidate(py_fs, self->parent->gfid);
+		return;
+	}
+
+	pyglfs_bcache_invalidate_range(py_fs, self->parent->gfid,
+				       pre->glfs_st_size, pre->glfs_st_size);
+	if (len != 0) {
+		pyglfs_bcache_invalidate_range(py_fs, self->parent->gfid,
+					       start, start + len - 1);
+	}
+}
+
 static PyObject *py_glfs_fd_ftruncate(PyObject *obj,
 				      PyObject *args,
 				      PyObject *kwargs_unused)
 {
 	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+	struct glfs_stat pre = { .glfs_st_mask = 0 };
+	struct glfs_stat post = { .glfs_st_mask = 0 };
 	off_t length;
 	int err;
 
@@ -281,14 +393,28 @@ static PyObject *py_glfs_fd_ftruncate(PyObject *obj,
 	}
 
 	Py_BEGIN_ALLOW_THREADS
-	err = glfs_ftruncate(self->fd, length, NULL, NULL);
+	err = glfs_ftruncate(self->fd, length, &pre, &post);
 	Py_END_ALLOW_THREADS
 
+	pyglfs_attr_cache_invalidate(self->parent->py_fs, self->parent->gfid);
+	if (err || (length < 0)) {
+		pyglfs_bcache_invalidate(self->parent->py_fs,
+					 self->parent->gfid);
+	} else if (length < pre.glfs_st_size) {
+		/* blocks past the new EOF */
+		fd_bcache_invalidate(self, &pre, length,
+				     pre.glfs_st_size - length);
+	} else {
+		fd_bcache_invalidate(self, &pre, 0, 0);
+	}
+	pyglfs_lease_cache_invalidate(self->lease_cache);
+
 	if (err) {
-		set_glfs_exc("glfs_ftruncate()");
-		return NULL;
+		return fd_fail(self, "glfs_ftruncate()");
 	}
 
+	fd_set_poststat(self, &post);
+
 	Py_RETURN_NONE;
 }
 
@@ -360,6 +486,8 @@ static PyObject *py_glfs_fd_pread(PyObject *obj,
 				  PyObject *kwargs_unused)
 {
 	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+	struct glfs_stat post = { .glfs_st_mask = 0 };
+	bool remote = false;
 	off_t offset;
 	Py_ssize_t cnt, n;
 	int flags = 0;
@@ -381,13 +509,31 @@ static PyObject *py_glfs_fd_pread(PyObject *obj,
 	}
 
 	Py_BEGIN_ALLOW_THREADS
-	n = glfs_pread(self->fd, PyBytes_AS_STRING(buffer), cnt, offset, flags, NULL);
+	if (self->lease_cache != NULL) {
+		n = pyglfs_lease_cache_pread(self->lease_cache,
+					     PyBytes_AS_STRING(buffer),
+					     cnt, offset);
+	} else if (self->dc_fd != -1) {
+		n = pread(self->dc_fd, PyBytes_AS_STRING(buffer), cnt, offset);
+	} else {
+		if (self->parent->py_fs->block_cache != NULL) {
+			n = pyglfs_bcache_pread(self, PyBytes_AS_STRING(buffer),
+						cnt, offset);
+		} else {
+			n = glfs_pread(self->fd, PyBytes_AS_STRING(buffer), cnt, offset, flags, &post);
+			remote = true;
+		}
+		pyglfs_dcache_fill(self, PyBytes_AS_STRING(buffer), cnt, n, offset);
+	}
 	Py_END_ALLOW_THREADS
 
 	if (n < 0) {
 		Py_DECREF(buffer);
-		set_glfs_exc("glfs_pread()");
-		return NULL;
+		return fd_fail(self, "glfs_pread()");
+	}
+
+	if (remote) {
+		fd_set_poststat(self, &post);
 	}
 
 	if (n != cnt) {
@@ -410,7 +556,9 @@ PyDoc_STRVAR(py_glfs_fd_pwrite__doc__,
 "    Position to which to write.\n\n"
 "Returns\n"
 "-------\n"
-"None\n"
+"int\n"
+"    Number of bytes written. In errno mode a failure returns the\n"
+"    negated errno.\n"
 );
 
 static PyObject *py_glfs_fd_pwrite(PyObject *obj,
@@ -422,6 +570,8 @@ static PyObject *py_glfs_fd_pwrite(PyObject *obj,
 	PyObject *buf = NULL;
 	Py_buffer buffer = {NULL, NULL};
 	off_t offset;
+	struct glfs_stat pre = { .glfs_st_mask = 0 };
+	struct glfs_stat post = { .glfs_st_mask = 0 };
 	Py_ssize_t _return_value;
 	int flags = 0;
 
@@ -452,13 +602,29 @@ static PyObject *py_glfs_fd_pwrite(PyObject *obj,
 	Py_BEGIN_ALLOW_THREADS
 	_return_value = glfs_pwrite(
 		self->fd, buffer.buf, (size_t)buffer.len, offset, flags,
-		NULL, NULL
+		&pre, &post
 	);
 	Py_END_ALLOW_THREADS
 
-	if (_return_value == -1) {
-		set_glfs_exc("glfs_pwrite()");
+	pyglfs_attr_cache_invalidate(self->parent->py_fs, self->parent->gfid);
+	if ((_return_value == -1) || (offset < 0)) {
+		pyglfs_bcache_invalidate(self->parent->py_fs,
+					 self->parent->gfid);
+	} else if (self->flags & O_APPEND) {
+		fd_bcache_invalidate(self, &pre, pre.glfs_st_size,
+				     _return_value);
+	} else {
+		fd_bcache_invalidate(self, &pre, offset, _return_value);
+	}
+	pyglfs_lease_cache_invalidate(self->lease_cache);
+
+	if ((_return_value == -1) && self->errno_mode) {
+		/* negated so it can't be mistaken for a byte count */
+		return_value = PyLong_FromLong(-errno);
+	} else if (_return_value == -1) {
+		return_value = fd_fail(self, "glfs_pwrite()");
 	} else {
+		fd_set_poststat(self, &post);
 		return_value = PyLong_FromSsize_t(_return_value);
 	}
 
@@ -561,9 +727,13 @@ static PyObject *py_glfs_fd_posix_lock(PyObject *obj,
 		return NULL;
 	}
 
+	/* closing the glfs fd is what drops its locks */
+	if (cmd != F_GETLK) {
+		self->poolable = false;
+	}
+
 	if (glfs_posix_lock(self->fd, cmd, &fl) != 0) {
-		set_glfs_exc("glfs_posix_lock()");
-		return NULL;
+		return fd_fail(self, "glfs_posix_lock()");
 	}
 
 	if (!verbose)
@@ -704,8 +874,7 @@ static PyObject *py_glfs_fd_fgetxattr(PyObject *obj,
 		Py_ssize_t buffer_size = buffer_sizes[i];
 
 		if (!buffer_size) {
-			set_glfs_exc("glfs_fgetxattr()");
-			return NULL;
+			return fd_fail(self, "glfs_fgetxattr()");
 		}
 
 		buffer = PyBytes_FromStringAndSize(NULL, buffer_size);
@@ -723,8 +892,7 @@ static PyObject *py_glfs_fd_fgetxattr(PyObject *obj,
 			if (errno == ERANGE)
 				continue;
 
-			set_glfs_exc("glfs_fgetxattr()");
-			return NULL;
+			return fd_fail(self, "glfs_fgetxattr()");
 		}
 
 		if (result != buffer_size) {
@@ -762,6 +930,7 @@ static PyObject *py_glfs_fd_fsetxattr(PyObject *obj,
 {
 	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
 	PyObject *buf = NULL;
+	PyObject *retval = NULL;
 	ssize_t result = -1;
 	const char *attr = NULL;
 	int flags;
@@ -797,7 +966,10 @@ static PyObject *py_glfs_fd_fsetxattr(PyObject *obj,
 	Py_END_ALLOW_THREADS;
 
 	if (result) {
-		set_glfs_exc("glfs_fsetxattr()");
+		retval = fd_fail(self, "glfs_fsetxattr()");
+	} else {
+		retval = Py_None;
+		Py_INCREF(retval);
 	}
 
 cleanup:
@@ -805,11 +977,7 @@ cleanup:
 		PyBuffer_Release(&value);
 	}
 
-	if (result == -1) {
-		return NULL;
-	}
-
-	Py_RETURN_NONE;
+	return retval;
 }
 
 PyDoc_STRVAR(py_glfs_fd_fremovexattr__doc__,
@@ -844,8 +1012,7 @@ static PyObject *py_glfs_fd_fremovexattr(PyObject *obj,
 	Py_END_ALLOW_THREADS;
 
 	if (err) {
-		set_glfs_exc("glfs_fremovexattr()");
-		return NULL;
+		return fd_fail(self, "glfs_fremovexattr()");
 	}
 
 	Py_RETURN_NONE;
@@ -939,7 +1106,95 @@ static PyMethodDef py_glfs_fd_methods[] = {
 	{ NULL, NULL, 0, NULL }
 };
 
+static PyObject *py_glfs_fd_get_errno_mode(PyObject *obj, void *closure)
+{
+	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+
+	return PyBool_FromLong(self->errno_mode);
+}
+
+static int py_glfs_fd_set_errno_mode(PyObject *obj, PyObject *value, void *closure)
+{
+	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+	int enabled;
+
+	if (value == NULL) {
+		PyErr_SetString(
+			PyExc_TypeError,
+			"Cannot delete errno_mode attribute."
+		);
+		return -1;
+	}
+
+	enabled = PyObject_IsTrue(value);
+	if (enabled == -1) {
+		return -1;
+	}
+
+	self->errno_mode = enabled;
+	return 0;
+}
+
+PyDoc_STRVAR(py_glfs_fd_errno_mode__doc__,
+"Return errno instead of raising GLFSError.\n"
+"If set to True, failures of the underlying glfs call in fstat(), fsync(),\n"
+"ftruncate(), pread(), posix_lock(), fgetxattr(), fsetxattr(),\n"
+"and fremovexattr() return the errno as an int rather than raising\n"
+"GLFSError. pwrite() returns the negated errno instead, since it\n"
+"returns the number of bytes written on success. Invalid arguments\n"
+"still raise exceptions.\n"
+);
+
+PyDoc_STRVAR(py_glfs_fd_lease_cache__doc__,
+"Statistics for lease-backed read cache of the file descriptor.\n"
+"None if FD was not opened with `lease_cache`, otherwise a dict\n"
+"containing `held` (whether read lease is still held), `hits`,\n"
+"`misses`, `recalls` and `bytes` (memory used by cached pages).\n"
+);
+
+static PyObject *py_glfs_fd_get_lease_cache(PyObject *obj, void *closure)
+{
+	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+
+	return pyglfs_lease_cache_stats_to_dict(self->lease_cache);
+}
+
+PyDoc_STRVAR(py_glfs_fd_last_stat__doc__,
+"stat_result from the post-op attributes returned by the most recent\n"
+"pread(), pwrite(), ftruncate() or fsync() on the FD, or from fstat().\n"
+"These also refresh `cached_stat` of the parent handle. None if no\n"
+"attributes have been received yet. Reads served from client-side\n"
+"caches do not return attributes.\n"
+);
+
+static PyObject *py_glfs_fd_get_last_stat(PyObject *obj, void *closure)
+{
+	py_glfs_fd_t *self = (py_glfs_fd_t *)obj;
+
+	if (!self->last_st.valid) {
+		Py_RETURN_NONE;
+	}
+
+	return compact_stat_to_pystat(&self->last_st);
+}
+
 static PyGetSetDef py_glfs_fd_getsetters[] = {
+	{
+		.name    = discard_const_p(char, "last_stat"),
+		.get     = (getter)py_glfs_fd_get_last_stat,
+		.doc     = py_glfs_fd_last_stat__doc__,
+	},
+	{
+		.name    = discard_const_p(char, "lease_cache"),
+		.get     = (getter)py_glfs_fd_get_lease_cache,
+		.doc     = py_glfs_fd_lease_cache__doc__,
+	},
+	{
+		.name    = discard_const_p(char, "errno_mode"),
+		.get     = (getter)py_glfs_fd_get_errno_mode,
+		.set     = (setter)py_glfs_fd_set_errno_mode,
+		.doc     = py_glfs_fd_errno_mode__doc__,
+	},
 	{ .name = NULL }
 };
 
@@ -0,0 +1,175 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Volume FD pool.
+ *
+ * Opening a file, reading from it and closing it costs a glfs_h_open()
+ * and a glfs_close() RPC. When the pool is enabled the glfs_fd_t of a
+ * released FD is kept open, keyed by (gfid, open flags), and handed to
+ * the next open() of the same file with the same flags instead of
+ * opening it again. An idle glfs_fd_t is used by one FD at a time.
+ * Only files opened read-only are pooled.
+ *
+ * Idle FDs are closed once they were idle for the pool TTL (checked on
+ * each use of the pool), when the pool is full, when the file is
+ * unlinked through pyglfs or changed by another client, and when the
+ * Volume is closed. FDs that took POSIX locks or leases are never
+ * pooled, and neither are opens that create or truncate the file.
+ */
+
+#define FDPOOL_KEY_SIZE (sizeof(uuid_t) + sizeof(int))
+#define FDPOOL_EXCLUDE_FLAGS (O_CREAT | O_EXCL | O_TRUNC | O_DIRECTORY)
+
+static void fdpool_key(unsigned char *key,
+		       const unsigned char *gfid,
+		       int flags)
+{
+	memcpy(key, gfid, sizeof(uuid_t));
+	memcpy(key + sizeof(uuid_t), &flags, sizeof(flags));
+}
+
+static void fdpool_evict(const void *key, size_t klen,
+			 const void *val, size_t vlen,
+			 void *private)
+{
+	glfs_fd_t *fd = NULL;
+
+	memcpy(&fd, val, sizeof(fd));
+	if (glfs_close(fd) == -1) {
+		fprintf(stderr, "glusterfs fd close failed: %s\n",
+			strerror(errno));
+	}
+}
+
+void pyglfs_fdpool_setup(pyglfs_cache_t *pool)
+{
+	pyglfs_cache_set_evict_cb(pool, fdpool_evict, NULL);
+}
+
+/*
+ * Only read-only fds are pooled: a writable fd must be closed so that
+ * write-behind is flushed and deferred write errors are reported.
+ */
+bool pyglfs_fdpool_eligible(py_glfs_t *py_fs, int flags)
+{
+	return (py_fs->fd_pool != NULL) &&
+	       ((flags & O_ACCMODE) == O_RDONLY) &&
+	       !(flags & FDPOOL_EXCLUDE_FLAGS);
+}
+
+/*
+ * Take idle fd for file opened with flags from the pool. Returns NULL
+ * if there is none. Called without the GIL.
+ */
+glfs_fd_t *pyglfs_fdpool_get(py_glfs_t *py_fs,
+			     const unsigned char *gfid,
+			     int flags)
+{
+	unsigned char key[FDPOOL_KEY_SIZE];
+	glfs_fd_t *fd = NULL;
+
+	if (!pyglfs_fdpool_eligible(py_fs, flags)) {
+		return NULL;
+	}
+
+	pyglfs_cache_expire(py_fs->fd_pool);
+
+	fdpool_key(key, gfid, flags);
+	if (!pyglfs_cache_take(py_fs->fd_pool, key, sizeof(key),
+			       &fd, sizeof(fd))) {
+		return NULL;
+	}
+
+	return fd;
+}
+
+/*
+ * Return fd to the pool. An idle fd already pooled for the same key is
+ * closed. Returns false if the fd was not pooled, in which case the
+ * caller closes it. Called without the GIL.
+ */
+bool pyglfs_fdpool_put(py_glfs_t *py_fs,
+		       const unsigned char *gfid,
+		       int flags,
+		       glfs_fd_t *fd)
+{
+	unsigned char key[FDPOOL_KEY_SIZE];
+
+	/* next user expects a fresh file offset */
+	if (glfs_lseek(fd, 0, SEEK_SET) == -1) {
+		return false;
+	}
+
+	pyglfs_cache_expire(py_fs->fd_pool);
+
+	fdpool_key(key, gfid, flags);
+	return pyglfs_cache_put(py_fs->fd_pool, key, sizeof(key),
+				&fd, sizeof(fd));
+}
+
+static bool fdpool_gfid_match(const void *key, size_t klen,
+			      const void *val, size_t vlen,
+			      void *private)
+{
+	return memcmp(key, private, sizeof(uuid_t)) == 0;
+}
+
+/* close idle fds of file, whatever their open flags */
+void pyglfs_fdpool_invalidate(py_glfs_t *py_fs, const unsigned char *gfid)
+{
+	if (py_fs->fd_pool == NULL) {
+		return;
+	}
+
+	pyglfs_cache_remove_if(py_fs->fd_pool, fdpool_gfid_match,
+			       discard_const(gfid));
+}
+
+/*
+ * Close idle fds of the file that `name` in directory `parent` refers
+ * to before it is unlinked. The whole pool is dropped if the dentry
+ * cache does not know the file. Called without the GIL as this may
+ * issue close RPCs.
+ */
+void pyglfs_fdpool_invalidate_name(py_glfs_t *py_fs,
+				   const unsigned char *parent,
+				   const char *name)
+{
+	uuid_t child;
+	bool negative = false;
+
+	if (py_fs->fd_pool == NULL) {
+		return;
+	}
+
+	if (pyglfs_dentry_cache_get(py_fs, parent, name, strlen(name),
+				    child, &negative)) {
+		if (!negative) {
+			pyglfs_fdpool_invalidate(py_fs, child);
+		}
+		return;
+	}
+
+	pyglfs_cache_clear(py_fs->fd_pool);
+}
@@ -44,6 +44,8 @@ typedef struct {
 	size_t depth;
 } py_glfs_ftsent_t;
 
+static pyglfs_freelist_t ftsent_freelist;
+
 static void py_glfs_ftsent_dealloc(py_glfs_ftsent_t *self)
 {
 	Py_CLEAR(self->fts_root);
@@ -51,14 +53,14 @@ static void py_glfs_ftsent_dealloc(py_glfs_ftsent_t *self)
 	Py_CLEAR(self->name);
 	Py_CLEAR(self->file_type);
 	Py_CLEAR(self->parent_path);
-	Py_TYPE(self)->tp_free((PyObject *)self);
+	pyglfs_freelist_free(&ftsent_freelist, &PyGlfsFTSENT, (PyObject *)self);
 }
 
 static PyObject *py_glfs_ftsent_new(PyTypeObject *obj,
 				    PyObject *args_unused,
 				    PyObject *kwargs_unused)
 {
-	return obj->tp_alloc(obj, 0);
+	return pyglfs_freelist_alloc(&ftsent_freelist, &PyGlfsFTSENT, obj);
 }
 
 PyDoc_STRVAR(ftsent_name__doc__,
@@ -352,6 +354,11 @@ static PyObject *py_fts_iter_next(py_glfs_fts_iter_t *self)
 		set_glfs_exc("glfs_object_copy()");
 	}
 
+	/* rv -1 indicates failure to read a directory */
+	if (rv == -1) {
+		set_glfs_exc("glfs_xreaddirplus_r()");
+	}
+
 	/*
 	 * rv 0 is a special value indicating that
 	 * we should stop iteration.
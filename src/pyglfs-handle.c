@@ -21,17 +21,13 @@
 #include "includes.h"
 #include "pyglfs.h"
 
+static pyglfs_freelist_t obj_freelist;
+
 static PyObject *py_glfs_obj_new(PyTypeObject *obj,
 				 PyObject *args_unused,
 				 PyObject *kwargs_unused)
 {
-	py_glfs_obj_t *self = NULL;
-
-	self = (py_glfs_obj_t *)obj->tp_alloc(obj, 0);
-	if (self == NULL) {
-		return NULL;
-	}
-	return (PyObject *)self;
+	return pyglfs_freelist_alloc(&obj_freelist, &PyGlfsObject, obj);
 }
 
 static int py_glfs_obj_init(PyObject *obj,
@@ -41,8 +37,154 @@ static int py_glfs_obj_init(PyObject *obj,
 	return 0;
 }
 
+/*
+ * Registry of live handles keyed by gfid. Handles are not referenced
+ * by the table and remove themselves on dealloc, so that the table
+ * behaves like a weak-value dict. Chain links live in table nodes
+ * rather than in the handles, so that handles of volumes without
+ * interning don't pay for them. Protected by the GIL.
+ */
+#define HANDLE_TABLE_MIN_BUCKETS 256
+
+typedef struct handle_node {
+	py_glfs_obj_t *hdl;
+	struct handle_node *next;
+} handle_node_t;
+
+struct pyglfs_handle_table {
+	handle_node_t **buckets;
+	size_t nbuckets;
+	size_t cnt;
+};
+
+pyglfs_handle_table_t *pyglfs_handle_table_new(void)
+{
+	pyglfs_handle_table_t *ht = NULL;
+
+	ht = calloc(1, sizeof(pyglfs_handle_table_t));
+	if (ht == NULL) {
+		return NULL;
+	}
+
+	ht->nbuckets = HANDLE_TABLE_MIN_BUCKETS;
+	ht->buckets = calloc(ht->nbuckets, sizeof(handle_node_t *));
+	if (ht->buckets == NULL) {
+		free(ht);
+		return NULL;
+	}
+
+	return ht;
+}
+
+/*
+ * Live handles hold a reference to the volume and so the table is
+ * empty by the time the volume is deallocated.
+ */
+void pyglfs_handle_table_free(pyglfs_handle_table_t *ht)
+{
+	if (ht == NULL) {
+		return;
+	}
+
+	free(ht->buckets);
+	free(ht);
+}
+
+static handle_node_t **handle_table_slot(pyglfs_handle_table_t *ht,
+					 const unsigned char *gfid)
+{
+	return &ht->buckets[pyglfs_hash(gfid, sizeof(uuid_t)) % ht->nbuckets];
+}
+
+static py_glfs_obj_t *handle_table_get(pyglfs_handle_table_t *ht,
+				       const unsigned char *gfid)
+{
+	handle_node_t *node = NULL;
+
+	for (node = *handle_table_slot(ht, gfid); node != NULL;
+	     node = node->next) {
+		if (memcmp(node->hdl->gfid, gfid, sizeof(uuid_t)) == 0) {
+			return node->hdl;
+		}
+	}
+
+	return NULL;
+}
+
+static void handle_table_grow(pyglfs_handle_table_t *ht)
+{
+	handle_node_t **old = ht->buckets;
+	size_t old_cnt = ht->nbuckets, i;
+
+	ht->buckets = calloc(old_cnt * 2, sizeof(handle_node_t *));
+	if (ht->buckets == NULL) {
+		/* keep using the current table with longer chains */
+		ht->buckets = old;
+		return;
+	}
+	ht->nbuckets = old_cnt * 2;
+
+	for (i = 0; i < old_cnt; i++) {
+		while (old[i] != NULL) {
+			handle_node_t *node = old[i];
+			handle_node_t **slot = handle_table_slot(ht,
+								 node->hdl->gfid);
+
+			old[i] = node->next;
+			node->next = *slot;
+			*slot = node;
+		}
+	}
+	free(old);
+}
+
+/*
+ * Handle is left out of the table if no node can be allocated. It then
+ * behaves like a handle of a volume without interning.
+ */
+static void handle_table_add(pyglfs_handle_table_t *ht, py_glfs_obj_t *hdl)
+{
+	handle_node_t *node = NULL, **slot = NULL;
+
+	node = malloc(sizeof(handle_node_t));
+	if (node == NULL) {
+		return;
+	}
+
+	if (ht->cnt >= ht->nbuckets) {
+		handle_table_grow(ht);
+	}
+
+	slot = handle_table_slot(ht, hdl->gfid);
+	node->hdl = hdl;
+	node->next = *slot;
+	*slot = node;
+	ht->cnt++;
+}
+
+static void handle_table_remove(pyglfs_handle_table_t *ht, py_glfs_obj_t *hdl)
+{
+	handle_node_t **pprev = NULL;
+
+	for (pprev = handle_table_slot(ht, hdl->gfid); *pprev != NULL;
+	     pprev = &(*pprev)->next) {
+		if ((*pprev)->hdl == hdl) {
+			handle_node_t *node = *pprev;
+
+			*pprev = node->next;
+			free(node);
+			ht->cnt--;
+			return;
+		}
+	}
+}
+
 void py_glfs_obj_dealloc(py_glfs_obj_t *self)
 {
+	if ((self->py_fs != NULL) && (self->py_fs->handles != NULL)) {
+		handle_table_remove(self->py_fs->handles, self);
+	}
+
 	if (self->gl_obj) {
 		if (glfs_h_close(self->gl_obj) == -1) {
 			fprintf(stderr, "glfs_h_close() failed: %s",
@@ -50,8 +192,49 @@ void py_glfs_obj_dealloc(py_glfs_obj_t *self)
 		}
 		self->gl_obj = NULL;
 	}
-	Py_CLEAR(self->py_fs);
-	Py_TYPE(self)->tp_free((PyObject *)self);
+	Py_CLEAR(self->name);
+	Py_CLEAR(self->pystat);
+	if (self->py_fs != NULL) {
+		pyglfs_volume_release(self->py_fs);
+		self->py_fs = NULL;
+	}
+	pyglfs_freelist_free(&obj_freelist, &PyGlfsObject, (PyObject *)self);
+}
+
+/*
+ * Update stat of handle. The stat_result built for the previous stat
+ * is kept if nothing changed.
+ */
+void pyglfs_obj_set_stat(py_glfs_obj_t *hdl, const struct stat *st)
+{
+	pyglfs_stat_t cst;
+
+	pyglfs_stat_pack(&cst, st);
+	if (memcmp(&cst, &hdl->st, sizeof(cst)) != 0) {
+		hdl->st = cst;
+		Py_CLEAR(hdl->pystat);
+	}
+}
+
+/*
+ * Returns new reference to stat_result for the handle, or None if
+ * stat is not populated.
+ */
+PyObject *pyglfs_obj_get_pystat(py_glfs_obj_t *hdl)
+{
+	if (!hdl->st.valid) {
+		Py_RETURN_NONE;
+	}
+
+	if (hdl->pystat == NULL) {
+		hdl->pystat = compact_stat_to_pystat(&hdl->st);
+		if (hdl->pystat == NULL) {
+			return NULL;
+		}
+	}
+
+	Py_INCREF(hdl->pystat);
+	return hdl->pystat;
 }
 
 PyObject *init_glfs_object(py_glfs_t *py_fs,
@@ -60,35 +243,56 @@ PyObject *init_glfs_object(py_glfs_t *py_fs,
 			   const char *name)
 {
 	py_glfs_obj_t *hdl = NULL;
-	uuid_t ui;
+	uuid_t gfid;
 	ssize_t rv;
 
-	hdl = (py_glfs_obj_t *)PyObject_CallNoArgs((PyObject *)&PyGlfsObject);
-	if (hdl == NULL) {
-		return NULL;
-	}
-
-	if (pst != NULL) {
-		memcpy(&hdl->st, pst, sizeof(struct stat));
-	}
-
 	Py_BEGIN_ALLOW_THREADS
-	rv = glfs_h_extract_handle(gl_obj, ui, sizeof(ui));
+	rv = glfs_h_extract_handle(gl_obj, gfid, sizeof(gfid));
 	Py_END_ALLOW_THREADS
 
 	if (rv == -1) {
 		set_glfs_exc("glfs_h_extract_handle()");
-		Py_DECREF(hdl);
 		return NULL;
 	}
 
+	if ((py_fs->handles != NULL) &&
+	    ((hdl = handle_table_get(py_fs->handles, gfid)) != NULL)) {
+		/* reuse live handle and drop the redundant inode ref */
+		Py_BEGIN_ALLOW_THREADS
+		glfs_h_close(gl_obj);
+		Py_END_ALLOW_THREADS
+
+		if (pst != NULL) {
+			pyglfs_obj_set_stat(hdl, pst);
+			pyglfs_attr_cache_put(py_fs, hdl->gfid, pst);
+		}
+		Py_INCREF(hdl);
+		return (PyObject *)hdl;
+	}
+
+	hdl = (py_glfs_obj_t *)PyObject_CallNoArgs((PyObject *)&PyGlfsObject);
+	if (hdl == NULL) {
+		return NULL;
+	}
+
+	if (pst != NULL) {
+		pyglfs_obj_set_stat(hdl, pst);
+	}
+	memcpy(hdl->gfid, gfid, sizeof(uuid_t));
+
 	if (name != NULL) {
 		hdl->name = PyUnicode_FromString(name);
 	}
-	uuid_unparse(ui, hdl->uuid_str);
+	if (pst != NULL) {
+		pyglfs_attr_cache_put(py_fs, hdl->gfid, pst);
+	}
+	pyglfs_volume_hold(py_fs);
 	hdl->py_fs = py_fs;
-	Py_INCREF(hdl->py_fs);
 	hdl->gl_obj = gl_obj;
+
+	if (py_fs->handles != NULL) {
+		handle_table_add(py_fs->handles, hdl);
+	}
 	return (PyObject *)hdl;
 }
 
@@ -143,6 +347,199 @@ PyDoc_STRVAR(py_glfs_obj_lookup__doc__,
 "    New GLFS handle\n"
 );
 
+/*
+ * Resolve path through the dentry cache one component at a time.
+ * Components that are not cached are looked up individually and
+ * added to the cache, so that later lookups of the same path only
+ * require a handle to be created for the final gfid.
+ *
+ * Returns false if path can't be resolved this way (absolute path,
+ * trailing slash, DOT / DOTDOT components, symlinks, stale entries), in
+ * which case caller should perform regular lookup. Cached entries whose
+ * attributes show a symlink are dropped, as the cache does not know
+ * whether the caller follows symlinks.
+ */
+static bool lookup_path_cached(py_glfs_obj_t *self,
+			       const char *path,
+			       struct stat *st,
+			       glfs_object_t **out)
+{
+	py_glfs_t *py_fs = self->py_fs;
+	glfs_object_t *cur = self->gl_obj, *next = NULL;
+	const char *comp = NULL, *end = NULL, *dname = NULL;
+	uuid_t gfid, child, dparent;
+	struct stat tmp;
+	size_t len, dlen = 0;
+	bool negative;
+	int err;
+
+	/* trailing slash requires a directory, leave that to glfs */
+	if ((*path == '/') || (*path == '\0') ||
+	    (path[strlen(path) - 1] == '/')) {
+		return false;
+	}
+
+	memcpy(gfid, self->gfid, sizeof(uuid_t));
+
+	for (comp = path; *comp != '\0'; comp = end) {
+		char name[NAME_MAX + 1];
+
+		end = strchrnul(comp, '/');
+		len = end - comp;
+		while (*end == '/') {
+			end++;
+		}
+
+		if ((len > NAME_MAX) ||
+		    ((len == 1) && (comp[0] == '.')) ||
+		    ((len == 2) && (comp[0] == '.') && (comp[1] == '.'))) {
+			goto fallback;
+		}
+
+		if (pyglfs_dentry_cache_get(py_fs, gfid, comp, len,
+					    child, &negative)) {
+			if (negative) {
+				err = ENOENT;
+				goto fail;
+			}
+			if (pyglfs_attr_cache_get(py_fs, child, &tmp) &&
+			    S_ISLNK(tmp.st_mode)) {
+				/* symlinks are resolved by regular lookup */
+				pyglfs_dentry_cache_invalidate(py_fs, gfid,
+							       comp, len);
+				goto fallback;
+			}
+			if (cur != self->gl_obj) {
+				glfs_h_close(cur);
+			}
+			cur = NULL;
+			goto next_comp;
+		}
+
+		if (cur == NULL) {
+			cur = glfs_h_create_from_handle(py_fs->fs, gfid,
+							sizeof(uuid_t), NULL);
+			if (cur == NULL) {
+				/* entry that produced gfid is stale */
+				pyglfs_dentry_cache_invalidate(py_fs, dparent,
+							       dname, dlen);
+				return false;
+			}
+		}
+
+		memcpy(name, comp, len);
+		name[len] = '\0';
+
+		next = glfs_h_lookupat(py_fs->fs, cur, name, &tmp, false);
+		if (next == NULL) {
+			err = errno;
+			if (err == ENOTDIR) {
+				/* parent may be a symlink without cached attrs */
+				goto fallback;
+			}
+			if (err == ENOENT) {
+				pyglfs_dentry_cache_put(py_fs, gfid, comp, len, NULL);
+			}
+			goto fail;
+		}
+
+		if (S_ISLNK(tmp.st_mode) ||
+		    (glfs_h_extract_handle(next, child, sizeof(uuid_t)) == -1)) {
+			glfs_h_close(next);
+			goto fallback;
+		}
+
+		pyglfs_dentry_cache_put(py_fs, gfid, comp, len, child);
+		pyglfs_attr_cache_put(py_fs, child, &tmp);
+
+		if (cur != self->gl_obj) {
+			glfs_h_close(cur);
+		}
+		cur = next;
+
+next_comp:
+		memcpy(dparent, gfid, sizeof(uuid_t));
+		memcpy(gfid, child, sizeof(uuid_t));
+		dname = comp;
+		dlen = len;
+	}
+
+	if (cur == self->gl_obj) {
+		return false;
+	}
+
+	if (cur != NULL) {
+		/* final component was looked up */
+		if (st != NULL) {
+			memcpy(st, &tmp, sizeof(struct stat));
+		}
+		*out = cur;
+		return true;
+	}
+
+	if ((st != NULL) && pyglfs_attr_cache_get(py_fs, gfid, st)) {
+		/* no RPC is required if inode is still in inode table */
+		*out = glfs_h_create_from_handle(py_fs->fs, gfid,
+						 sizeof(uuid_t), NULL);
+	} else {
+		*out = glfs_h_create_from_handle(py_fs->fs, gfid,
+						 sizeof(uuid_t), st);
+	}
+
+	if ((*out != NULL) && (st != NULL) && S_ISLNK(st->st_mode)) {
+		glfs_h_close(*out);
+		*out = NULL;
+	}
+
+	if (*out == NULL) {
+		pyglfs_dentry_cache_invalidate(py_fs, dparent, dname, dlen);
+		return false;
+	}
+
+	return true;
+
+fail:
+	if ((cur != NULL) && (cur != self->gl_obj)) {
+		glfs_h_close(cur);
+	}
+	*out = NULL;
+	errno = err;
+	return true;
+
+fallback:
+	if ((cur != NULL) && (cur != self->gl_obj)) {
+		glfs_h_close(cur);
+	}
+	return false;
+}
+
+/*
+ * Resolve path relative to the handle. Called without the GIL.
+ */
+static glfs_object_t *lookup_path(py_glfs_obj_t *self,
+				  const char *path,
+				  struct stat *st,
+				  bool follow)
+{
+	glfs_object_t *gl_obj = NULL;
+
+	if ((self->py_fs->dentry_cache != NULL) &&
+	    lookup_path_cached(self, path, st, &gl_obj)) {
+		return gl_obj;
+	}
+
+	return glfs_h_lookupat(self->py_fs->fs, self->gl_obj, path, st, follow);
+}
+
+/*
+ * Lookup failures that simply mean that the path does not exist.
+ * Probe methods report these without constructing an exception.
+ */
+static bool is_lookup_miss(int err)
+{
+	return (err == ENOENT) || (err == ENOTDIR);
+}
+
 static PyObject *py_glfs_obj_lookup(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
@@ -160,13 +557,7 @@ static PyObject *py_glfs_obj_lookup(PyObject *obj, PyObject *args, PyObject *kwa
 	}
 
 	Py_BEGIN_ALLOW_THREADS
-	gl_obj = glfs_h_lookupat(
-		self->py_fs->fs,
-		self->gl_obj,
-		path,
-		do_stat ? &st : NULL,
-		follow
-	);
+	gl_obj = lookup_path(self, path, do_stat ? &st : NULL, follow);
 	Py_END_ALLOW_THREADS
 
 	if (gl_obj == NULL) {
@@ -177,117 +568,1153 @@ static PyObject *py_glfs_obj_lookup(PyObject *obj, PyObject *args, PyObject *kwa
 	return init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
 }
 
-PyDoc_STRVAR(py_glfs_obj_create__doc__,
-"create(path, flags, stat=False, symlink_follow=False, mode=0o644)\n"
+PyDoc_STRVAR(py_glfs_obj_try_lookup__doc__,
+"try_lookup(path, stat=True, symlink_follow=True)\n"
 "--\n\n"
-"Create new GLFS object (file) by path.\n\n"
+"Lookup GLFS object by path if it exists.\n"
+"Same as lookup(), except that None is returned if path does not exist\n"
+"(ENOENT or ENOTDIR) rather than raising GLFSError.\n\n"
 "Parameters\n"
 "----------\n"
 "path : str\n"
 "    Path of object relative to this handle.\n"
-"flags : int\n"
-"    open(2) flags to use to open the handle.\n"
 "stat : bool, optional, default=True\n"
-"    Retrieve stat information for object while performing create.\n"
+"    Retrieve stat information for object while performing lookup.\n"
 "symlink_follow: bool, optional, default=True\n"
-"    Follow symlinks while performing create.\n\n"
-"mode : bool, optional, default=0o644\n"
-"    Permissions to set on newly created directory.\n\n"
+"    Follow symlinks while performing lookup.\n\n"
 "Returns\n"
 "-------\n"
-"pyglfs.ObjectHandle\n"
+"pyglfs.ObjectHandle or None\n"
 "    New GLFS handle\n"
 );
 
-static PyObject *py_glfs_obj_create(PyObject *obj, PyObject *args, PyObject *kwargs)
+static PyObject *py_glfs_obj_try_lookup(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
 	glfs_object_t *gl_obj = NULL;
 	char *path = NULL;
 	struct stat st;
-	bool do_stat = true;
-	int flags = 0;
-	int mode = 420; /* 0o644 */
-	const char *kwnames [] = { "path", "flags", "stat", "mode", NULL };
+	bool do_stat = true, follow = true;
+	const char *kwnames [] = { "path", "stat", "symlink_follow", NULL };
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "si|bi",
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|bb",
 					 discard_const_p(char *, kwnames),
-					 &path, &flags,
-					 &do_stat, &mode)) {
+					 &path,
+					 &do_stat, &follow)) {
 		return NULL;
 	}
 
 	Py_BEGIN_ALLOW_THREADS
-	gl_obj = glfs_h_creat(
-		self->py_fs->fs,
-		self->gl_obj,
-		path,
-		flags,
-		mode,
-		do_stat ? &st : NULL
-	);
+	gl_obj = lookup_path(self, path, do_stat ? &st : NULL, follow);
 	Py_END_ALLOW_THREADS
 
 	if (gl_obj == NULL) {
-		set_glfs_exc("glfs_h_creat()");
+		if (is_lookup_miss(errno)) {
+			Py_RETURN_NONE;
+		}
+		set_glfs_exc("glfs_h_lookupat()");
+		return NULL;
+	}
+
+	return init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
+}
+
+PyDoc_STRVAR(py_glfs_obj_exists__doc__,
+"exists(path, symlink_follow=True)\n"
+"--\n\n"
+"Check whether path exists relative to this handle.\n"
+"No handle is created for the object.\n\n"
+"Parameters\n"
+"----------\n"
+"path : str\n"
+"    Path of object relative to this handle.\n"
+"symlink_follow: bool, optional, default=True\n"
+"    Follow symlinks while performing lookup.\n\n"
+"Returns\n"
+"-------\n"
+"bool\n"
+"    False if lookup fails with ENOENT or ENOTDIR.\n"
+);
+
+static PyObject *py_glfs_obj_exists(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	glfs_object_t *gl_obj = NULL;
+	char *path = NULL;
+	bool follow = true;
+	const char *kwnames [] = { "path", "symlink_follow", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|b",
+					 discard_const_p(char *, kwnames),
+					 &path, &follow)) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	gl_obj = lookup_path(self, path, NULL, follow);
+	if (gl_obj != NULL) {
+		glfs_h_close(gl_obj);
+	}
+	Py_END_ALLOW_THREADS
+
+	if (gl_obj != NULL) {
+		Py_RETURN_TRUE;
+	}
+
+	if (is_lookup_miss(errno)) {
+		Py_RETURN_FALSE;
+	}
+
+	set_glfs_exc("glfs_h_lookupat()");
+	return NULL;
+}
+
+/*
+ * Copy a python list of file names into a single allocation that
+ * holds the pointer array followed by the strings, so that names
+ * remain valid while the GIL is released. Free with free().
+ */
+static char **copy_name_list(PyObject *names, size_t *cnt_out)
+{
+	PyObject *seq = NULL;
+	char **out = NULL;
+	char *arena = NULL;
+	size_t i, cnt, len = 0;
+
+	seq = PySequence_Fast(names, "names must be a list of strings.");
+	if (seq == NULL) {
+		return NULL;
+	}
+
+	cnt = PySequence_Fast_GET_SIZE(seq);
+	for (i = 0; i < cnt; i++) {
+		PyObject *name = PySequence_Fast_GET_ITEM(seq, i);
+		Py_ssize_t sz;
+		const char *cname;
+
+		if (!PyUnicode_Check(name)) {
+			PyErr_Format(
+				PyExc_TypeError,
+				"names entry %zu is not a string.", i
+			);
+			Py_DECREF(seq);
+			return NULL;
+		}
+
+		cname = PyUnicode_AsUTF8AndSize(name, &sz);
+		if (cname == NULL) {
+			Py_DECREF(seq);
+			return NULL;
+		}
+
+		if ((sz == 0) || (strchr(cname, '/') != NULL)) {
+			PyErr_Format(
+				PyExc_ValueError,
+				"%s: names entry %zu is not a valid file name.",
+				cname, i
+			);
+			Py_DECREF(seq);
+			return NULL;
+		}
+		len += sz + 1;
+	}
+
+	/* +1 so that empty lists don't return NULL */
+	out = malloc((cnt * sizeof(char *)) + len + 1);
+	if (out == NULL) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	arena = (char *)(out + cnt);
+	for (i = 0; i < cnt; i++) {
+		out[i] = arena;
+		arena = stpcpy(arena, PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i))) + 1;
+	}
+
+	Py_DECREF(seq);
+	*cnt_out = cnt;
+	return out;
+}
+
+/*
+ * Batch lookup planner.
+ *
+ * Resolving a batch of names in a directory can be done either with
+ * one glfs_h_lookupat() per name or with a single readdirplus pass over
+ * the directory that picks out the wanted names from a hash table.
+ * The cost of the latter is roughly proportional to the number of
+ * entries in the directory, which we estimate from its cached stat.
+ */
+#define LOOKUP_PLAN_DIRENTS_PER_RPC	64	/* entries per readdirp reply */
+#define LOOKUP_PLAN_DIRENT_SIZE		32	/* est. bytes of st_size per entry */
+#define LOOKUP_PLAN_SCAN_OVERHEAD	3	/* opendir, EOF readdirp, release */
+
+enum lookup_strategy {
+	LOOKUP_STRATEGY_AUTO,
+	LOOKUP_STRATEGY_LOOKUP,
+	LOOKUP_STRATEGY_READDIRPLUS,
+};
+
+struct lookup_batch {
+	size_t cnt;
+	char **names;
+	size_t *first;		/* index of first occurrence of name */
+	glfs_object_t **objs;
+	struct stat *st;
+	size_t *table;		/* open addressing, SIZE_MAX is empty */
+	size_t table_sz;
+	size_t unique;
+	size_t found;
+	bool do_stat;
+	int err;
+	const char *err_name;
+};
+
+static bool lookup_batch_find(struct lookup_batch *b,
+			      const char *name,
+			      size_t *idx)
+{
+	size_t slot = pyglfs_hash(name, strlen(name)) & (b->table_sz - 1);
+
+	while (b->table[slot] != SIZE_MAX) {
+		if (strcmp(b->names[b->table[slot]], name) == 0) {
+			*idx = b->table[slot];
+			return true;
+		}
+		slot = (slot + 1) & (b->table_sz - 1);
+	}
+
+	*idx = slot;
+	return false;
+}
+
+static void lookup_batch_free(struct lookup_batch *b)
+{
+	size_t i;
+
+	if (b->objs != NULL) {
+		for (i = 0; i < b->cnt; i++) {
+			if (b->objs[i] != NULL) {
+				glfs_h_close(b->objs[i]);
+			}
+		}
+	}
+
+	free(b->names);
+	free(b->first);
+	free(b->objs);
+	free(b->st);
+	free(b->table);
+}
+
+static bool lookup_batch_init(struct lookup_batch *b,
+			      PyObject *names,
+			      bool do_stat)
+{
+	size_t i;
+
+	*b = (struct lookup_batch) { .do_stat = do_stat };
+
+	b->names = copy_name_list(names, &b->cnt);
+	if (b->names == NULL) {
+		return false;
+	}
+
+	b->first = calloc(b->cnt, sizeof(size_t));
+	b->objs = calloc(b->cnt, sizeof(glfs_object_t *));
+	b->st = calloc(b->cnt, sizeof(struct stat));
+	for (b->table_sz = 16; b->table_sz < (b->cnt * 2); b->table_sz *= 2);
+	b->table = malloc(b->table_sz * sizeof(size_t));
+
+	if (!b->first || !b->objs || !b->st || !b->table) {
+		lookup_batch_free(b);
+		PyErr_NoMemory();
+		return false;
+	}
+
+	memset(b->table, 0xff, b->table_sz * sizeof(size_t));
+
+	for (i = 0; i < b->cnt; i++) {
+		size_t slot;
+
+		if (lookup_batch_find(b, b->names[i], &slot)) {
+			/* duplicate name, resolved from first occurrence */
+			b->first[i] = slot;
+			continue;
+		}
+
+		b->table[slot] = i;
+		b->first[i] = i;
+		b->unique++;
+	}
+
+	return true;
+}
+
+static bool lookup_batch_do_lookup(py_glfs_obj_t *self,
+				   struct lookup_batch *b,
+				   size_t idx)
+{
+	b->objs[idx] = glfs_h_lookupat(
+		self->py_fs->fs,
+		self->gl_obj,
+		b->names[idx],
+		b->do_stat ? &b->st[idx] : NULL,
+		false
+	);
+	if ((b->objs[idx] == NULL) && (errno != ENOENT)) {
+		b->err = errno;
+		b->err_name = b->names[idx];
+		return false;
+	}
+
+	return true;
+}
+
+static bool lookup_batch_cb(py_glfs_obj_t *root,
+			    glfs_object_t *obj,
+			    struct dirent *entry,
+			    struct stat *st,
+			    size_t depth,
+			    const char *parent_path,
+			    void *private)
+{
+	struct lookup_batch *b = (struct lookup_batch *)private;
+	size_t idx;
+
+	if (!lookup_batch_find(b, entry->d_name, &idx) ||
+	    (b->objs[idx] != NULL)) {
+		return true;
+	}
+
+	if (obj == NULL) {
+		/* readdirplus may omit the handle, look it up by name */
+		if (!lookup_batch_do_lookup(root, b, idx)) {
+			return false;
+		}
+	} else {
+		b->objs[idx] = glfs_object_copy(obj);
+		if (b->objs[idx] == NULL) {
+			b->err = errno;
+			b->err_name = b->names[idx];
+			return false;
+		}
+
+		if (b->do_stat && (st != NULL)) {
+			memcpy(&b->st[idx], st, sizeof(struct stat));
+		}
+	}
+
+	/* stop reading the directory once everything has been found */
+	b->found++;
+	return b->found < b->unique;
+}
+
+static bool lookup_batch_do_readdirplus(py_glfs_obj_t *self,
+					struct lookup_batch *b)
+{
+	glfs_fd_t *fd = NULL;
+	int rv;
+	glfs_object_cb_t iter_cb = {
+		.state = b,
+		.flags = b->do_stat ? PYGLFS_FTS_FLAG_DO_STAT : 0,
+		.fn = lookup_batch_cb,
+		.max_depth = 0,
+	};
+
+	if (b->unique == 0) {
+		return true;
+	}
+
+	fd = glfs_h_opendir(self->py_fs->fs, self->gl_obj);
+	if (fd == NULL) {
+		b->err = errno;
+		b->err_name = "glfs_h_opendir()";
+		return false;
+	}
+
+	iter_cb.root.fd = fd;
+	rv = iter_glfs_object_handle(self, &iter_cb);
+	if ((rv == -1) && (b->err == 0)) {
+		b->err = errno;
+		b->err_name = "glfs_xreaddirplus_r()";
+	}
+	glfs_closedir(fd);
+
+	return b->err == 0;
+}
+
+static enum lookup_strategy lookup_batch_plan(py_glfs_obj_t *self,
+					      struct lookup_batch *b)
+{
+	uint64_t est_entries, scan_rpcs;
+
+	est_entries = self->st.st_size / LOOKUP_PLAN_DIRENT_SIZE;
+	if ((self->st.st_nlink > 2) && (self->st.st_nlink - 2 > est_entries)) {
+		est_entries = self->st.st_nlink - 2;
+	}
+
+	scan_rpcs = (est_entries / LOOKUP_PLAN_DIRENTS_PER_RPC) +
+		    LOOKUP_PLAN_SCAN_OVERHEAD;
+
+	return (scan_rpcs < b->unique) ?
+	       LOOKUP_STRATEGY_READDIRPLUS : LOOKUP_STRATEGY_LOOKUP;
+}
+
+PyDoc_STRVAR(py_glfs_obj_lookup_many__doc__,
+"lookup_many(names, stat=True, strategy='auto')\n"
+"--\n\n"
+"Lookup a batch of existing GLFS objects by name in this directory.\n"
+"Names are resolved either by individual lookups, or by a single\n"
+"readdirplus pass over the directory if the batch is large relative to\n"
+"the size of the directory (as estimated from its cached stat).\n"
+"Symlinks are not followed.\n\n"
+"Parameters\n"
+"----------\n"
+"names : list\n"
+"    List of names of entries in this directory. Names may not contain `/`.\n"
+"stat : bool, optional, default=True\n"
+"    Retrieve stat information for objects while performing lookup.\n"
+"strategy : str, optional, default='auto'\n"
+"    One of `auto`, `lookup`, or `readdirplus`. `auto` picks a strategy\n"
+"    based on number of names and estimated directory size.\n\n"
+"Returns\n"
+"-------\n"
+"dict\n"
+"    `strategy` - strategy used to resolve the names (`LOOKUP` or\n"
+"    `READDIRPLUS`).\n"
+"    `handles` - list of pyglfs.ObjectHandle, or None if name does not\n"
+"    exist, in the same order as `names`.\n"
+);
+
+static PyObject *py_glfs_obj_lookup_many(PyObject *obj,
+					 PyObject *args,
+					 PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *names = NULL;
+	PyObject *handles = NULL;
+	const char *strategy_str = "auto";
+	enum lookup_strategy strategy;
+	struct lookup_batch b;
+	bool do_stat = true, ok = true;
+	size_t i;
+	int err = 0;
+	const char *kwnames [] = { "names", "stat", "strategy", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|bs",
+					 discard_const_p(char *, kwnames),
+					 &names, &do_stat, &strategy_str)) {
+		return NULL;
+	}
+
+	if (strcmp(strategy_str, "auto") == 0) {
+		strategy = LOOKUP_STRATEGY_AUTO;
+	} else if (strcmp(strategy_str, "lookup") == 0) {
+		strategy = LOOKUP_STRATEGY_LOOKUP;
+	} else if (strcmp(strategy_str, "readdirplus") == 0) {
+		strategy = LOOKUP_STRATEGY_READDIRPLUS;
+	} else {
+		PyErr_Format(
+			PyExc_ValueError,
+			"%s: invalid strategy. Permitted values are "
+			"`auto`, `lookup`, and `readdirplus`.",
+			strategy_str
+		);
+		return NULL;
+	}
+
+	if (!self->st.valid) {
+		struct stat st;
+
+		/* planner needs the directory size */
+		Py_BEGIN_ALLOW_THREADS
+		err = glfs_h_stat(self->py_fs->fs, self->gl_obj, &st);
+		Py_END_ALLOW_THREADS
+
+		if (err) {
+			set_glfs_exc("glfs_h_stat()");
+			return NULL;
+		}
+		pyglfs_obj_set_stat(self, &st);
+	}
+
+	if (!S_ISDIR(self->st.st_mode)) {
+		errno = ENOTDIR;
+		set_glfs_exc("lookup_many()");
+		return NULL;
+	}
+
+	if (!lookup_batch_init(&b, names, do_stat)) {
+		return NULL;
+	}
+
+	if (strategy == LOOKUP_STRATEGY_AUTO) {
+		strategy = lookup_batch_plan(self, &b);
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	if (strategy == LOOKUP_STRATEGY_READDIRPLUS) {
+		ok = lookup_batch_do_readdirplus(self, &b);
+	} else {
+		for (i = 0; ok && (i < b.cnt); i++) {
+			if (b.first[i] == i) {
+				ok = lookup_batch_do_lookup(self, &b, i);
+			}
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	if (!ok) {
+		errno = b.err;
+		set_glfs_exc(b.err_name);
+		lookup_batch_free(&b);
+		return NULL;
+	}
+
+	handles = PyList_New(b.cnt);
+	if (handles == NULL) {
+		lookup_batch_free(&b);
+		return NULL;
+	}
+
+	/*
+	 * Walk backwards so that duplicates copy the object before
+	 * the first occurrence of the name takes ownership of it.
+	 */
+	for (i = b.cnt; i-- > 0;) {
+		PyObject *hdl = NULL;
+		glfs_object_t *gl_obj = b.objs[b.first[i]];
+
+		if (gl_obj == NULL) {
+			Py_INCREF(Py_None);
+			PyList_SET_ITEM(handles, i, Py_None);
+			continue;
+		}
+
+		if (b.first[i] != i) {
+			gl_obj = glfs_object_copy(gl_obj);
+			if (gl_obj == NULL) {
+				set_glfs_exc("glfs_object_copy()");
+				ok = false;
+				break;
+			}
+		} else {
+			/* ownership passes to the python handle */
+			b.objs[i] = NULL;
+		}
+
+		hdl = init_glfs_object(
+			self->py_fs, gl_obj,
+			do_stat ? &b.st[b.first[i]] : NULL,
+			b.names[i]
+		);
+		if (hdl == NULL) {
+			glfs_h_close(gl_obj);
+			ok = false;
+			break;
+		}
+		PyList_SET_ITEM(handles, i, hdl);
+	}
+
+	lookup_batch_free(&b);
+
+	if (!ok) {
+		Py_DECREF(handles);
+		return NULL;
+	}
+
+	return Py_BuildValue(
+		"{s:s,s:N}",
+		"strategy",
+		strategy == LOOKUP_STRATEGY_READDIRPLUS ? "READDIRPLUS" : "LOOKUP",
+		"handles", handles
+	);
+}
+
+PyDoc_STRVAR(py_glfs_obj_create__doc__,
+"create(path, flags, stat=False, symlink_follow=False, mode=0o644)\n"
+"--\n\n"
+"Create new GLFS object (file) by path.\n\n"
+"Parameters\n"
+"----------\n"
+"path : str\n"
+"    Path of object relative to this handle.\n"
+"flags : int\n"
+"    open(2) flags to use to open the handle.\n"
+"stat : bool, optional, default=True\n"
+"    Retrieve stat information for object while performing create.\n"
+"symlink_follow: bool, optional, default=True\n"
+"    Follow symlinks while performing create.\n\n"
+"mode : bool, optional, default=0o644\n"
+"    Permissions to set on newly created directory.\n\n"
+"Returns\n"
+"-------\n"
+"pyglfs.ObjectHandle\n"
+"    New GLFS handle\n"
+);
+
+static PyObject *py_glfs_obj_create(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *out = NULL;
+	glfs_object_t *gl_obj = NULL;
+	char *path = NULL;
+	struct stat st;
+	bool do_stat = true;
+	int flags = 0;
+	int mode = 420; /* 0o644 */
+	const char *kwnames [] = { "path", "flags", "stat", "mode", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "si|bi",
+					 discard_const_p(char *, kwnames),
+					 &path, &flags,
+					 &do_stat, &mode)) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	gl_obj = glfs_h_creat(
+		self->py_fs->fs,
+		self->gl_obj,
+		path,
+		flags,
+		mode,
+		do_stat ? &st : NULL
+	);
+	Py_END_ALLOW_THREADS
+
+	if (gl_obj == NULL) {
+		set_glfs_exc("glfs_h_creat()");
+		return NULL;
+	}
+
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+
+	out = init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
+	if (out != NULL) {
+		pyglfs_dentry_cache_put(self->py_fs, self->gfid, path, strlen(path),
+					((py_glfs_obj_t *)out)->gfid);
+	}
+
+	return out;
+}
+
+PyDoc_STRVAR(py_glfs_obj_mkdir__doc__,
+"mkdir(path, stat=False, mode=0o755)\n"
+"--\n\n"
+"Create new GLFS object (directory) by path.\n\n"
+"Parameters\n"
+"----------\n"
+"path : str\n"
+"    Path of object relative to this handle.\n"
+"flags : int\n"
+"    open(2) flags to use to open the handle.\n"
+"stat : bool, optional, default=True\n"
+"    Retrieve stat information for object while performing create.\n"
+"mode : bool, optional, default=0o755\n"
+"    Permissions to set on newly created directory.\n\n"
+"Returns\n"
+"-------\n"
+"pyglfs.ObjectHandle\n"
+"    New GLFS handle\n"
+);
+
+static PyObject *py_glfs_obj_mkdir(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *out = NULL;
+	glfs_object_t *gl_obj = NULL;
+	char *path = NULL;
+	struct stat st;
+	bool do_stat = true;
+	int mode = 493; /* 0o755 */
+	const char *kwnames [] = { "path", "stat", "mode", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|bi",
+					 discard_const_p(char *, kwnames),
+					 &path, &do_stat, &mode)) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	gl_obj = glfs_h_mkdir(
+		self->py_fs->fs,
+		self->gl_obj,
+		path,
+		mode,
+		do_stat ? &st : NULL
+	);
+	Py_END_ALLOW_THREADS
+
+	if (gl_obj == NULL) {
+		set_glfs_exc("glfs_h_mkdir()");
+		return NULL;
+	}
+
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+
+	out = init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
+	if (out != NULL) {
+		pyglfs_dentry_cache_put(self->py_fs, self->gfid, path, strlen(path),
+					((py_glfs_obj_t *)out)->gfid);
+	}
+
+	return out;
+}
+
+/*
+ * Bulk creation of entries under one parent directory.
+ */
+enum bulk_create_op {
+	BULK_OP_MKDIR,
+	BULK_OP_CREATE,
+};
+
+struct bulk_create {
+	glfs_t *fs;
+	glfs_object_t *parent;
+	enum bulk_create_op op;
+	int flags;
+	bool do_stat;
+	bool keep_handles;
+	size_t cnt;
+	char **names;
+	mode_t *modes;
+	glfs_object_t **objs;
+	struct stat *st;
+	int *err;
+};
+
+static void bulk_create_free(struct bulk_create *b)
+{
+	size_t i;
+
+	if (b->objs != NULL) {
+		for (i = 0; i < b->cnt; i++) {
+			if (b->objs[i] != NULL) {
+				glfs_h_close(b->objs[i]);
+			}
+		}
+	}
+
+	free(b->names);
+	free(b->modes);
+	free(b->objs);
+	free(b->st);
+	free(b->err);
+}
+
+/*
+ * Parse list of (name, mode) tuples. Bare strings are
+ * accepted as well and get the default mode.
+ */
+static bool bulk_create_init(struct bulk_create *b,
+			     PyObject *specs,
+			     int default_mode)
+{
+	PyObject *seq = NULL;
+	size_t i, len = 0;
+	char *arena = NULL;
+
+	seq = PySequence_Fast(specs, "specs must be a list of (name, mode) tuples.");
+	if (seq == NULL) {
+		return false;
+	}
+
+	b->cnt = PySequence_Fast_GET_SIZE(seq);
+	b->modes = calloc(b->cnt, sizeof(mode_t));
+	if (b->modes == NULL) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return false;
+	}
+
+	for (i = 0; i < b->cnt; i++) {
+		PyObject *spec = PySequence_Fast_GET_ITEM(seq, i);
+		PyObject *name = spec;
+		const char *cname = NULL;
+		Py_ssize_t sz;
+		int mode = default_mode;
+
+		if (PyTuple_Check(spec) &&
+		    !PyArg_ParseTuple(spec, "U|i", &name, &mode)) {
+			Py_DECREF(seq);
+			return false;
+		} else if (!PyUnicode_Check(name)) {
+			PyErr_Format(
+				PyExc_TypeError,
+				"specs entry %zu is not a (name, mode) tuple.", i
+			);
+			Py_DECREF(seq);
+			return false;
+		}
+
+		cname = PyUnicode_AsUTF8AndSize(name, &sz);
+		if (cname == NULL) {
+			Py_DECREF(seq);
+			return false;
+		}
+
+		if ((sz == 0) || (strchr(cname, '/') != NULL)) {
+			PyErr_Format(
+				PyExc_ValueError,
+				"%s: specs entry %zu is not a valid file name.",
+				cname, i
+			);
+			Py_DECREF(seq);
+			return false;
+		}
+
+		b->modes[i] = (mode_t)mode;
+		len += sz + 1;
+	}
+
+	b->names = malloc((b->cnt * sizeof(char *)) + len);
+	b->objs = calloc(b->cnt, sizeof(glfs_object_t *));
+	b->st = calloc(b->cnt, sizeof(struct stat));
+	b->err = calloc(b->cnt, sizeof(int));
+	if (!b->names || !b->objs || !b->st || !b->err) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return false;
+	}
+
+	arena = (char *)(b->names + b->cnt);
+	for (i = 0; i < b->cnt; i++) {
+		PyObject *spec = PySequence_Fast_GET_ITEM(seq, i);
+		PyObject *name = PyTuple_Check(spec) ? PyTuple_GET_ITEM(spec, 0) : spec;
+
+		b->names[i] = arena;
+		arena = stpcpy(arena, PyUnicode_AsUTF8(name)) + 1;
+	}
+
+	Py_DECREF(seq);
+	return true;
+}
+
+static void bulk_create_job(size_t idx, void *private)
+{
+	struct bulk_create *b = (struct bulk_create *)private;
+	struct stat *st = b->do_stat ? &b->st[idx] : NULL;
+	glfs_object_t *obj = NULL;
+
+	if (b->op == BULK_OP_MKDIR) {
+		obj = glfs_h_mkdir(b->fs, b->parent, b->names[idx],
+				   b->modes[idx], st);
+	} else {
+		obj = glfs_h_creat(b->fs, b->parent, b->names[idx],
+				   b->flags, b->modes[idx], st);
+	}
+
+	if (obj == NULL) {
+		b->err[idx] = errno;
+		return;
+	}
+
+	if (b->keep_handles) {
+		b->objs[idx] = obj;
+	} else {
+		glfs_h_close(obj);
+	}
+}
+
+static PyObject *bulk_create_run(py_glfs_obj_t *self,
+				 struct bulk_create *b,
+				 int threads)
+{
+	PyObject *out = NULL;
+	size_t i;
+
+	b->fs = self->py_fs->fs;
+	b->parent = self->gl_obj;
+
+	Py_BEGIN_ALLOW_THREADS
+	pyglfs_run_jobs(b->cnt, threads, bulk_create_job, b);
+	Py_END_ALLOW_THREADS
+
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+
+	for (i = 0; i < b->cnt; i++) {
+		if (b->err[i] == 0) {
+			/* drop any negative entry for the new name */
+			pyglfs_dentry_cache_invalidate(self->py_fs, self->gfid,
+						       b->names[i],
+						       strlen(b->names[i]));
+		}
+	}
+
+	for (i = 0; i < b->cnt; i++) {
+		if (b->err[i]) {
+			errno = b->err[i];
+			set_glfs_exc(b->names[i]);
+			bulk_create_free(b);
+			return NULL;
+		}
+	}
+
+	if (!b->keep_handles) {
+		bulk_create_free(b);
+		Py_RETURN_NONE;
+	}
+
+	out = PyList_New(b->cnt);
+	if (out == NULL) {
+		bulk_create_free(b);
+		return NULL;
+	}
+
+	for (i = 0; i < b->cnt; i++) {
+		PyObject *hdl = NULL;
+
+		hdl = init_glfs_object(
+			self->py_fs, b->objs[i],
+			b->do_stat ? &b->st[i] : NULL,
+			b->names[i]
+		);
+		if (hdl == NULL) {
+			Py_CLEAR(out);
+			break;
+		}
+		/* ownership passes to the python handle */
+		b->objs[i] = NULL;
+		PyList_SET_ITEM(out, i, hdl);
+	}
+
+	bulk_create_free(b);
+	return out;
+}
+
+PyDoc_STRVAR(py_glfs_obj_mkdir_many__doc__,
+"mkdir_many(specs, stat=False, return_handles=True, threads=1)\n"
+"--\n\n"
+"Create many new GLFS objects (directories) in this directory.\n"
+"Entries are created in a native loop, optionally from multiple\n"
+"threads, without returning to python between entries. If any entry\n"
+"fails, GLFSError is raised for the first failed entry. Other entries\n"
+"that were successfully created are not removed.\n\n"
+"Parameters\n"
+"----------\n"
+"specs : list\n"
+"    List of (name, mode) tuples. A bare name may be given instead of\n"
+"    a tuple, in which case mode 0o755 is used.\n"
+"stat : bool, optional, default=False\n"
+"    Retrieve stat information for objects while performing create.\n"
+"return_handles : bool, optional, default=True\n"
+"    Return handles for new objects. If False, no python objects\n"
+"    are created for the new entries and None is returned.\n"
+"threads : int, optional, default=1\n"
+"    Number of threads to use for creating entries.\n\n"
+"Returns\n"
+"-------\n"
+"list of pyglfs.ObjectHandle or None\n"
+);
+
+static PyObject *py_glfs_obj_mkdir_many(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *specs = NULL;
+	struct bulk_create b = { .op = BULK_OP_MKDIR, .keep_handles = true };
+	int threads = 1;
+	const char *kwnames [] = {
+		"specs", "stat", "return_handles", "threads", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|bbi",
+					 discard_const_p(char *, kwnames),
+					 &specs, &b.do_stat,
+					 &b.keep_handles, &threads)) {
+		return NULL;
+	}
+
+	if (!pyglfs_check_threads(threads)) {
+		return NULL;
+	}
+
+	if (!bulk_create_init(&b, specs, 493 /* 0o755 */)) {
+		bulk_create_free(&b);
+		return NULL;
+	}
+
+	return bulk_create_run(self, &b, threads);
+}
+
+PyDoc_STRVAR(py_glfs_obj_create_many__doc__,
+"create_many(specs, flags, stat=False, return_handles=True, threads=1)\n"
+"--\n\n"
+"Create many new GLFS objects (files) in this directory.\n"
+"Entries are created in a native loop, optionally from multiple\n"
+"threads, without returning to python between entries. If any entry\n"
+"fails, GLFSError is raised for the first failed entry. Other entries\n"
+"that were successfully created are not removed.\n\n"
+"Parameters\n"
+"----------\n"
+"specs : list\n"
+"    List of (name, mode) tuples. A bare name may be given instead of\n"
+"    a tuple, in which case mode 0o644 is used.\n"
+"flags : int\n"
+"    open(2) flags to use to create the files.\n"
+"stat : bool, optional, default=False\n"
+"    Retrieve stat information for objects while performing create.\n"
+"return_handles : bool, optional, default=True\n"
+"    Return handles for new objects. If False, no python objects\n"
+"    are created for the new entries and None is returned.\n"
+"threads : int, optional, default=1\n"
+"    Number of threads to use for creating entries.\n\n"
+"Returns\n"
+"-------\n"
+"list of pyglfs.ObjectHandle or None\n"
+);
+
+static PyObject *py_glfs_obj_create_many(PyObject *obj, PyObject *args, PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *specs = NULL;
+	struct bulk_create b = { .op = BULK_OP_CREATE, .keep_handles = true };
+	int threads = 1;
+	const char *kwnames [] = {
+		"specs", "flags", "stat", "return_handles", "threads", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi|bbi",
+					 discard_const_p(char *, kwnames),
+					 &specs, &b.flags, &b.do_stat,
+					 &b.keep_handles, &threads)) {
+		return NULL;
+	}
+
+	if (!pyglfs_check_threads(threads)) {
+		return NULL;
+	}
+
+	if (!bulk_create_init(&b, specs, 420 /* 0o644 */)) {
+		bulk_create_free(&b);
 		return NULL;
 	}
 
-	return init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
+	return bulk_create_run(self, &b, threads);
 }
 
-PyDoc_STRVAR(py_glfs_obj_mkdir__doc__,
-"mkdir(path, stat=False, mode=0o755)\n"
+PyDoc_STRVAR(py_glfs_obj_makedirs__doc__,
+"makedirs(path, mode=0o755, exist_ok=False, stat=True)\n"
 "--\n\n"
-"Create new GLFS object (directory) by path.\n\n"
+"Create directory path relative to this handle, including any missing\n"
+"intermediate directories. See documentation for os.makedirs().\n\n"
 "Parameters\n"
 "----------\n"
 "path : str\n"
-"    Path of object relative to this handle.\n"
-"flags : int\n"
-"    open(2) flags to use to open the handle.\n"
+"    Path of directory relative to this handle. Absolute paths are\n"
+"    rejected with ValueError.\n"
+"mode : int, optional, default=0o755\n"
+"    Permissions to set on newly created directories.\n"
+"exist_ok : bool, optional, default=False\n"
+"    Do not fail if the target directory already exists.\n"
 "stat : bool, optional, default=True\n"
-"    Retrieve stat information for object while performing create.\n"
-"mode : bool, optional, default=0o755\n"
-"    Permissions to set on newly created directory.\n\n"
+"    Retrieve stat information for the target directory.\n\n"
 "Returns\n"
 "-------\n"
 "pyglfs.ObjectHandle\n"
-"    New GLFS handle\n"
+"    GLFS handle for the target directory\n"
 );
 
-static PyObject *py_glfs_obj_mkdir(PyObject *obj, PyObject *args, PyObject *kwargs)
+static PyObject *py_glfs_obj_makedirs(PyObject *obj, PyObject *args, PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
-	glfs_object_t *gl_obj = NULL;
-	char *path = NULL;
+	glfs_t *fs = self->py_fs->fs;
+	glfs_object_t *cur = self->gl_obj, *next = NULL;
+	char *path = NULL, *buf = NULL, *comp = NULL, *saveptr = NULL;
 	struct stat st;
-	bool do_stat = true;
+	bool do_stat = true, exist_ok = false, created = false;
 	int mode = 493; /* 0o755 */
-	const char *kwnames [] = { "path", "stat", "mode", NULL };
+	int err = 0;
+	const char *kwnames [] = { "path", "mode", "exist_ok", "stat", NULL };
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|bi",
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|ibb",
 					 discard_const_p(char *, kwnames),
-					 &path, &do_stat, &mode)) {
+					 &path, &mode, &exist_ok, &do_stat)) {
+		return NULL;
+	}
+
+	if (*path == '/') {
+		PyErr_SetString(
+			PyExc_ValueError,
+			"path must be relative to the handle"
+		);
 		return NULL;
 	}
 
+	buf = strdup(path);
+	if (buf == NULL) {
+		return PyErr_NoMemory();
+	}
+
 	Py_BEGIN_ALLOW_THREADS
-	gl_obj = glfs_h_mkdir(
-		self->py_fs->fs,
-		self->gl_obj,
-		path,
-		mode,
-		do_stat ? &st : NULL
-	);
+	for (comp = strtok_r(buf, "/", &saveptr); comp != NULL;
+	     comp = strtok_r(NULL, "/", &saveptr)) {
+		if (strcmp(comp, ".") == 0) {
+			continue;
+		}
+
+		created = false;
+		next = glfs_h_lookupat(fs, cur, comp, &st, true);
+		if ((next == NULL) && (errno == ENOENT)) {
+			next = glfs_h_mkdir(fs, cur, comp, mode, &st);
+			if ((next == NULL) && (errno == EEXIST)) {
+				/* lost race with another creator */
+				next = glfs_h_lookupat(fs, cur, comp, &st, true);
+			} else if (next != NULL) {
+				uuid_t parent;
+
+				created = true;
+				if (glfs_h_extract_handle(cur, parent, sizeof(parent)) != -1) {
+					pyglfs_attr_cache_invalidate(self->py_fs, parent);
+					pyglfs_dentry_cache_invalidate(self->py_fs, parent,
+								       comp, strlen(comp));
+				}
+			}
+		}
+
+		if (next == NULL) {
+			err = errno;
+		} else if (!S_ISDIR(st.st_mode)) {
+			err = saveptr && *saveptr ? ENOTDIR : EEXIST;
+			glfs_h_close(next);
+			next = NULL;
+		}
+
+		if (cur != self->gl_obj) {
+			glfs_h_close(cur);
+		}
+		cur = next;
+
+		if (cur == NULL) {
+			break;
+		}
+	}
 	Py_END_ALLOW_THREADS
 
-	if (gl_obj == NULL) {
-		set_glfs_exc("glfs_h_mkdir()");
+	free(buf);
+
+	if ((err == 0) && (cur == self->gl_obj)) {
+		/* path consisted only of separators and dots */
+		err = EEXIST;
+		cur = NULL;
+	} else if ((err == 0) && !created && !exist_ok) {
+		err = EEXIST;
+	}
+
+	if (err) {
+		if (cur != NULL) {
+			glfs_h_close(cur);
+		}
+		errno = err;
+		set_glfs_exc(path);
 		return NULL;
 	}
 
-	return init_glfs_object(self->py_fs, gl_obj, do_stat ? &st : NULL, path);
+	return init_glfs_object(self->py_fs, cur, do_stat ? &st : NULL, path);
 }
 
 PyDoc_STRVAR(py_glfs_obj_unlink__doc__,
@@ -323,29 +1750,168 @@ static PyObject *py_glfs_obj_unlink(PyObject *obj,
 		set_glfs_exc("glfs_h_unlink()");
 		return NULL;
 	}
+
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+	if (self->py_fs->fd_pool != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		pyglfs_fdpool_invalidate_name(self->py_fs, self->gfid, path);
+		Py_END_ALLOW_THREADS
+	}
+	pyglfs_dentry_cache_put(self->py_fs, self->gfid, path, strlen(path), NULL);
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR(py_glfs_obj_unlink_many__doc__,
+"unlink_many(names, threads=1, ignore_missing=True)\n"
+"--\n\n"
+"Unlink (delete) many names in this directory.\n"
+"The unlink requests are issued concurrently from up to `threads`\n"
+"native threads without holding the GIL. Failures do not stop\n"
+"processing of the remaining names.\n\n"
+"Parameters\n"
+"----------\n"
+"names : list\n"
+"    List of names of entries in this directory.\n"
+"threads : int, optional, default=1\n"
+"    Number of threads to use for unlinking.\n"
+"ignore_missing : bool, optional, default=True\n"
+"    Do not report names that do not exist (ENOENT).\n\n"
+"Returns\n"
+"-------\n"
+"errors : list\n"
+"    List of (name, errno) tuples for names that failed to be unlinked.\n"
+"    Empty list if all names were unlinked.\n"
+);
+
+struct bulk_unlink {
+	glfs_t *fs;
+	glfs_object_t *parent;
+	char **names;
+	int *err;
+};
+
+static void bulk_unlink_job(size_t idx, void *private)
+{
+	struct bulk_unlink *b = (struct bulk_unlink *)private;
+
+	if (glfs_h_unlink(b->fs, b->parent, b->names[idx]) != 0) {
+		b->err[idx] = errno;
+	}
+}
+
+static PyObject *py_glfs_obj_unlink_many(PyObject *obj,
+					 PyObject *args,
+					 PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	PyObject *names = NULL, *out = NULL;
+	struct bulk_unlink b = {
+		.fs = self->py_fs->fs,
+		.parent = self->gl_obj,
+	};
+	bool ignore_missing = true;
+	int threads = 1;
+	size_t cnt, i;
+	const char *kwnames [] = {
+		"names", "threads", "ignore_missing", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ib",
+					 discard_const_p(char *, kwnames),
+					 &names, &threads, &ignore_missing)) {
+		return NULL;
+	}
+
+	if (!pyglfs_check_threads(threads)) {
+		return NULL;
+	}
+
+	b.names = copy_name_list(names, &cnt);
+	if (b.names == NULL) {
+		return NULL;
+	}
+
+	b.err = calloc(cnt, sizeof(int));
+	if (b.err == NULL) {
+		free(b.names);
+		return PyErr_NoMemory();
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pyglfs_run_jobs(cnt, threads, bulk_unlink_job, &b);
+	for (i = 0; i < cnt; i++) {
+		if ((b.err[i] == 0) || (b.err[i] == ENOENT)) {
+			pyglfs_fdpool_invalidate_name(self->py_fs, self->gfid,
+						      b.names[i]);
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+	for (i = 0; i < cnt; i++) {
+		if ((b.err[i] == 0) || (b.err[i] == ENOENT)) {
+			pyglfs_dentry_cache_put(self->py_fs, self->gfid,
+						b.names[i], strlen(b.names[i]),
+						NULL);
+		}
+	}
+
+	out = PyList_New(0);
+	for (i = 0; (out != NULL) && (i < cnt); i++) {
+		PyObject *entry = NULL;
+
+		if ((b.err[i] == 0) ||
+		    (ignore_missing && (b.err[i] == ENOENT))) {
+			continue;
+		}
+
+		entry = Py_BuildValue("(si)", b.names[i], b.err[i]);
+		if ((entry == NULL) || (PyList_Append(out, entry) == -1)) {
+			Py_CLEAR(out);
+		}
+		Py_XDECREF(entry);
+	}
+
+	free(b.names);
+	free(b.err);
+	return out;
+}
+
 PyDoc_STRVAR(py_glfs_obj_stat__doc__,
-"stat()\n"
+"stat(use_cache=True)\n"
 "--\n\n"
 "Stat the glfs object. Performs fresh stat and updates\n"
-"cache for object.\n\n"
+"cache for object. If the attribute cache is enabled for the\n"
+"volume, stat information is returned from it when available.\n\n"
 "Parameters\n"
 "----------\n"
-"None\n\n"
+"use_cache : bool, optional, default=True\n"
+"    Consult volume attribute cache before performing stat.\n\n"
 "Returns\n"
 "-------\n"
 "stat_result\n"
 );
 
 static PyObject *py_glfs_obj_stat(PyObject *obj,
-				  PyObject *args_unused,
-				  PyObject *kwargs_unused)
+				  PyObject *args,
+				  PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
 	struct stat st;
+	bool use_cache = true;
 	int err;
+	const char *kwnames [] = { "use_cache", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|b",
+					 discard_const_p(char *, kwnames),
+					 &use_cache)) {
+		return NULL;
+	}
+
+	if (use_cache && pyglfs_attr_cache_get(self->py_fs, self->gfid, &st)) {
+		pyglfs_obj_set_stat(self, &st);
+		return pyglfs_obj_get_pystat(self);
+	}
 
 	Py_BEGIN_ALLOW_THREADS
 	err = glfs_h_stat(self->py_fs->fs, self->gl_obj, &st);
@@ -356,18 +1922,28 @@ static PyObject *py_glfs_obj_stat(PyObject *obj,
 		return NULL;
 	}
 
-	memcpy(&self->st, &st, sizeof(struct stat));
-	return stat_to_pystat(&st);
+	pyglfs_obj_set_stat(self, &st);
+	pyglfs_attr_cache_put(self->py_fs, self->gfid, &st);
+	return pyglfs_obj_get_pystat(self);
 }
 
 PyDoc_STRVAR(py_glfs_obj_open__doc__,
-"open(flags)\n"
+"open(flags, lease_cache=False, lease_cache_size=1048576)\n"
 "--\n\n"
 "Open a GLFS file descriptor.\n\n"
 "Parameters\n"
 "----------\n"
 "flags : int\n"
-"    open(2) flags to use to open the handle. O_CREAT is not supported.\n\n"
+"    open(2) flags to use to open the handle. O_CREAT is not supported.\n"
+"lease_cache : bool, optional, default=False\n"
+"    Acquire a read lease for the file and serve pread() from an\n"
+"    in-process page cache while the lease is held. Cached pages are\n"
+"    dropped when the servers recall the lease, after which reads go\n"
+"    to the servers. Requires `features.leases` to be enabled on the\n"
+"    volume.\n"
+"lease_cache_size : int, optional, default=1048576\n"
+"    Maximum number of bytes from the start of the file to cache.\n"
+"    Reads beyond this point are not cached.\n\n"
 "Returns\n"
 "-------\n"
 "pyglfs.FD\n"
@@ -375,21 +1951,51 @@ PyDoc_STRVAR(py_glfs_obj_open__doc__,
 );
 static PyObject *py_glfs_obj_open(PyObject *obj,
 				  PyObject *args,
-				  PyObject *kwargs_unused)
+				  PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	py_glfs_fd_t *pyfd = NULL;
 	glfs_fd_t *gl_fd = NULL;
+	pyglfs_lease_cache_t *lc = NULL;
+	glfs_leaseid_t lease_id;
+	bool lease_cache = false;
+	Py_ssize_t lease_cache_size = PYGLFS_DEFAULT_LEASE_CACHE_BYTES;
 	int flags;
+	const char *kwnames [] = {
+		"flags", "lease_cache", "lease_cache_size", NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|bn",
+					 discard_const_p(char *, kwnames),
+					 &flags, &lease_cache,
+					 &lease_cache_size)) {
+		return NULL;
+	}
 
-	if (!PyArg_ParseTuple(args, "i", &flags)) {
+	if (lease_cache && ((flags & O_DIRECTORY) || (lease_cache_size < 1))) {
+		PyErr_SetString(
+			PyExc_ValueError,
+			"lease_cache requires a regular file and a positive "
+			"lease_cache_size"
+		);
 		return NULL;
 	}
 
 	Py_BEGIN_ALLOW_THREADS
 	if (flags & O_DIRECTORY) {
 		gl_fd = glfs_h_opendir(self->py_fs->fs, self->gl_obj);
-	} else {
+	} else if (lease_cache) {
+		/* lease id of the thread is bound to the fd on open */
+		uuid_generate((unsigned char *)lease_id);
+		glfs_setfsleaseid(lease_id);
 		gl_fd = glfs_h_open(self->py_fs->fs, self->gl_obj, flags);
+		glfs_setfsleaseid(NULL);
+	} else {
+		gl_fd = pyglfs_fdpool_get(self->py_fs, self->gfid, flags);
+		if (gl_fd == NULL) {
+			gl_fd = glfs_h_open(self->py_fs->fs, self->gl_obj,
+					    flags);
+		}
 	}
 	Py_END_ALLOW_THREADS
 
@@ -398,11 +2004,31 @@ static PyObject *py_glfs_obj_open(PyObject *obj,
 		return NULL;
 	}
 
-	return init_glfs_fd(gl_fd, self, flags);
+	pyfd = (py_glfs_fd_t *)init_glfs_fd(gl_fd, self, flags);
+	if ((pyfd == NULL) || !lease_cache) {
+		if (pyfd != NULL) {
+			pyfd->poolable = pyglfs_fdpool_eligible(self->py_fs,
+								flags);
+		}
+		return (PyObject *)pyfd;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	lc = pyglfs_lease_cache_new(gl_fd, lease_id, lease_cache_size);
+	Py_END_ALLOW_THREADS
+
+	if (lc == NULL) {
+		set_glfs_exc("glfs_lease()");
+		Py_DECREF(pyfd);
+		return NULL;
+	}
+
+	pyfd->lease_cache = lc;
+	return (PyObject *)pyfd;
 }
 
 PyDoc_STRVAR(py_glfs_obj_contents__doc__,
-"contents()\n"
+"contents(stream=False)\n"
 "--\n\n"
 "Read handle contents. Return will vary depending on underlying\n"
 "file type.\n"
@@ -411,11 +2037,13 @@ PyDoc_STRVAR(py_glfs_obj_contents__doc__,
 "SYMLINK - destination of symlink\n\n"
 "Parameters\n"
 "----------\n"
-"flags : int\n"
-"    open(2) flags to use to open the handle. O_CREAT is not supported.\n\n"
+"stream : bool, optional, default=False\n"
+"    For a DIRECTORY, return an iterator that reads entry names from\n"
+"    the server in batches rather than a list of all names. Ignored\n"
+"    for other file types.\n\n"
 "Returns\n"
 "-------\n"
-"contents : bytes (FILE), list (DIRECTORY), str (SYMLINK)\n"
+"contents : bytes (FILE), list or iterator (DIRECTORY), str (SYMLINK)\n"
 );
 
 static PyObject *read_contents_reg(py_glfs_obj_t *self)
@@ -458,111 +2086,6 @@ static PyObject *read_contents_reg(py_glfs_obj_t *self)
 	return data;
 }
 
-typedef char dstring[256];
-
-struct d_array {
-	dstring *dirs;
-	size_t next_idx;
-	size_t alloc;
-};
-
-static bool get_dir_listing(glfs_fd_t *fd, struct d_array *arr)
-{
-	struct dirent prev, *result = NULL;
-	int err;
-
-	*arr = (struct d_array) {
-		.dirs = NULL,
-		.next_idx = 0,
-		.alloc = 16
-	};
-
-	arr->dirs = calloc(arr->alloc, sizeof(dstring));
-	if (arr->dirs == NULL) {
-		return false;
-	}
-
-	for (;;) {
-		err = glfs_readdir_r(fd, &prev, &result);
-		if (err) {
-			free(arr->dirs);
-			arr->dirs = NULL;
-			return false;
-		}
-		if (result == NULL) {
-			break;
-		}
-
-		if (strcmp(result->d_name, ".") == 0 ||
-		    (strcmp(result->d_name, "..") == 0)) {
-			continue;
-		}
-
-		strlcpy(arr->dirs[arr->next_idx], result->d_name, sizeof(dstring));
-		arr->next_idx++;
-		if (arr->next_idx == arr->alloc) {
-			dstring *new_dirs = NULL;
-			arr->alloc *= 8;
-			new_dirs = realloc(arr->dirs, sizeof(dstring) * arr->alloc);
-			if (new_dirs == NULL) {
-				free(arr->dirs);
-				arr->dirs = NULL;
-				return false;
-			}
-
-			arr->dirs = new_dirs;
-		}
-	}
-
-	return true;
-}
-
-static PyObject *read_contents_dir(py_glfs_obj_t *self)
-{
-	PyObject *data = NULL;
-	struct d_array arr;
-	glfs_fd_t *gl_fd = NULL;
-	bool ok;
-	size_t i;
-
-	Py_BEGIN_ALLOW_THREADS
-	gl_fd = glfs_h_opendir(self->py_fs->fs, self->gl_obj);
-	Py_END_ALLOW_THREADS
-	if (gl_fd == NULL) {
-		set_glfs_exc("glfs_h_opendir()");
-		return NULL;
-	}
-	Py_BEGIN_ALLOW_THREADS
-	ok = get_dir_listing(gl_fd, &arr);
-	glfs_closedir(gl_fd);
-	Py_END_ALLOW_THREADS
-	if (!ok) {
-		set_glfs_exc("glfs_h_readdir()");
-		return NULL;
-	}
-
-	data = PyList_New(arr.next_idx);
-	if (data == NULL) {
-		return NULL;
-	}
-
-	for (i = 0; i < arr.next_idx; i++) {
-		PyObject *pydir = NULL;
-		pydir = PyUnicode_FromString(arr.dirs[i]);
-		if (pydir == NULL) {
-			Py_CLEAR(data);
-			break;
-		}
-
-		if (PyList_SetItem(data, i, pydir) == -1) {
-			Py_CLEAR(data);
-			break;
-		}
-	}
-	free(arr.dirs);
-	return data;
-}
-
 static PyObject *read_contents_lnk(py_glfs_obj_t *self)
 {
 	/* readlink does not NULL-terminate after copying */
@@ -582,15 +2105,27 @@ static PyObject *read_contents_lnk(py_glfs_obj_t *self)
 }
 
 static PyObject *py_glfs_obj_contents(PyObject *obj,
-				      PyObject *args_unused,
-				      PyObject *kwargs_unused)
+				      PyObject *args,
+				      PyObject *kwargs)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
 	PyObject *rv = NULL;
+	bool stream = false;
+	const char *kwnames [] = { "stream", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|b",
+					 discard_const_p(char *, kwnames),
+					 &stream)) {
+		return NULL;
+	}
 
 	switch (self->st.st_mode & S_IFMT) {
 	case S_IFDIR:
-		rv = read_contents_dir(self);
+		if (stream) {
+			rv = init_glfs_dir_stream(self);
+		} else {
+			rv = pyglfs_dir_listing(self);
+		}
 		break;
 	case S_IFREG:
 		rv = read_contents_reg(self);
@@ -608,6 +2143,40 @@ static PyObject *py_glfs_obj_contents(PyObject *obj,
 	return rv;
 }
 
+PyDoc_STRVAR(py_glfs_obj_scandir__doc__,
+"scandir(stat=True)\n"
+"--\n\n"
+"Iterate entries of this directory, similar to os.scandir().\n"
+"Entries are read with readdirplus in batches. is_dir(), is_file() and\n"
+"is_symlink() use the type returned in the directory entry and stat()\n"
+"uses the attributes returned by readdirplus, so that neither requires\n"
+"an RPC per entry. ObjectHandles are created on demand by handle().\n\n"
+"Parameters\n"
+"----------\n"
+"stat : bool, optional, default=True\n"
+"    Retrieve stat information for entries while reading the directory.\n\n"
+"Returns\n"
+"-------\n"
+"iterator of pyglfs.DirEntry\n"
+);
+
+static PyObject *py_glfs_obj_scandir(PyObject *obj,
+				     PyObject *args,
+				     PyObject *kwargs)
+{
+	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	bool do_stat = true;
+	const char *kwnames [] = { "stat", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|b",
+					 discard_const_p(char *, kwnames),
+					 &do_stat)) {
+		return NULL;
+	}
+
+	return init_glfs_scandir(self, do_stat);
+}
+
 PyDoc_STRVAR(py_glfs_obj_fts_open__doc__,
 "fts_open(stat=true, max_depth=-1)\n"
 "--\n\n"
@@ -671,6 +2240,7 @@ static bool setattrs_cb(py_glfs_obj_t *root,
 			void *private)
 {
 	struct setattrs_cb_state *st = (struct setattrs_cb_state *)private;
+	uuid_t gfid;
 	int rv;
 
 	rv = glfs_h_setattrs(root->py_fs->fs, tmp_obj, st->to_set, st->valid);
@@ -678,6 +2248,10 @@ static bool setattrs_cb(py_glfs_obj_t *root,
 		strlcpy(st->path, parent_path, sizeof(st->path));
 		return false;
 	}
+
+	if (glfs_h_extract_handle(tmp_obj, gfid, sizeof(gfid)) != -1) {
+		pyglfs_attr_cache_invalidate(root->py_fs, gfid);
+	}
 	return true;
 }
 
@@ -852,6 +2426,8 @@ static PyObject *py_glfs_obj_setattrs(PyObject *obj,
 	rv = glfs_h_setattrs(self->py_fs->fs, self->gl_obj, &to_set, valid);
 	Py_END_ALLOW_THREADS
 
+	pyglfs_attr_cache_invalidate(self->py_fs, self->gfid);
+
 	if (rv == -1) {
 		set_glfs_exc("glfs_h_setattrs()");
 		return NULL;
@@ -871,6 +2447,24 @@ static PyMethodDef py_glfs_obj_methods[] = {
 		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_lookup__doc__
 	},
+	{
+		.ml_name = "try_lookup",
+		.ml_meth = (PyCFunction)py_glfs_obj_try_lookup,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_try_lookup__doc__
+	},
+	{
+		.ml_name = "exists",
+		.ml_meth = (PyCFunction)py_glfs_obj_exists,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_exists__doc__
+	},
+	{
+		.ml_name = "lookup_many",
+		.ml_meth = (PyCFunction)py_glfs_obj_lookup_many,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_lookup_many__doc__
+	},
 	{
 		.ml_name = "create",
 		.ml_meth = (PyCFunction)py_glfs_obj_create,
@@ -883,22 +2477,46 @@ static PyMethodDef py_glfs_obj_methods[] = {
 		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_mkdir__doc__
 	},
+	{
+		.ml_name = "mkdir_many",
+		.ml_meth = (PyCFunction)py_glfs_obj_mkdir_many,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_mkdir_many__doc__
+	},
+	{
+		.ml_name = "create_many",
+		.ml_meth = (PyCFunction)py_glfs_obj_create_many,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_create_many__doc__
+	},
+	{
+		.ml_name = "makedirs",
+		.ml_meth = (PyCFunction)py_glfs_obj_makedirs,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_makedirs__doc__
+	},
 	{
 		.ml_name = "unlink",
 		.ml_meth = (PyCFunction)py_glfs_obj_unlink,
 		.ml_flags = METH_VARARGS,
 		.ml_doc = py_glfs_obj_unlink__doc__
 	},
+	{
+		.ml_name = "unlink_many",
+		.ml_meth = (PyCFunction)py_glfs_obj_unlink_many,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_unlink_many__doc__
+	},
 	{
 		.ml_name = "stat",
 		.ml_meth = (PyCFunction)py_glfs_obj_stat,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_stat__doc__
 	},
 	{
 		.ml_name = "open",
 		.ml_meth = (PyCFunction)py_glfs_obj_open,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_open__doc__
 	},
 	{
@@ -907,10 +2525,16 @@ static PyMethodDef py_glfs_obj_methods[] = {
 		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_fts_open__doc__
 	},
+	{
+		.ml_name = "scandir",
+		.ml_meth = (PyCFunction)py_glfs_obj_scandir,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_obj_scandir__doc__
+	},
 	{
 		.ml_name = "contents",
 		.ml_meth = (PyCFunction)py_glfs_obj_contents,
-		.ml_flags = METH_VARARGS,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
 		.ml_doc = py_glfs_obj_contents__doc__
 	},
 	{
@@ -925,20 +2549,15 @@ static PyMethodDef py_glfs_obj_methods[] = {
 static PyObject *py_glfs_obj_get_uuid(PyObject *obj, void *closure)
 {
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
+	char uuid_str[37];
 
-	return Py_BuildValue("s", self->uuid_str);
+	uuid_unparse(self->gfid, uuid_str);
+	return PyUnicode_FromString(uuid_str);
 }
 
 static PyObject *py_glfs_obj_get_stat(PyObject *obj, void *closure)
 {
-	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
-
-	if (self->st.st_dev == 0) {
-		/* stat struct is not populated */
-		Py_RETURN_NONE;
-	}
-
-	return stat_to_pystat(&self->st);
+	return pyglfs_obj_get_pystat((py_glfs_obj_t *)obj);
 }
 
 static PyObject *py_glfs_obj_get_file_type(PyObject *obj, void *closure)
@@ -946,8 +2565,7 @@ static PyObject *py_glfs_obj_get_file_type(PyObject *obj, void *closure)
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
 	PyObject *file_type_str = NULL;
 
-	if (self->st.st_dev == 0) {
-		/* stat struct is not populated */
+	if (!self->st.valid) {
 		Py_RETURN_NONE;
 	}
 
@@ -1031,7 +2649,9 @@ static PyObject *py_glfs_obj_repr(PyObject *obj)
 	py_glfs_obj_t *self = (py_glfs_obj_t *)obj;
 	PyObject *file_type_str = NULL;
 	PyObject *out = NULL;
+	char uuid_str[37];
 
+	uuid_unparse(self->gfid, uuid_str);
 	file_type_str = py_file_type_str(self->st.st_mode);
 	if (file_type_str == NULL) {
 		return NULL;
@@ -1039,7 +2659,7 @@ static PyObject *py_glfs_obj_repr(PyObject *obj)
 
 	out = PyUnicode_FromFormat(
 		"pyglfs.ObjectHandle(uuid=%s, name=%V, file_type=%U)",
-		self->uuid_str, self->name, "<UNKNOWN>", file_type_str
+		uuid_str, self->name, "<UNKNOWN>", file_type_str
 	);
 
 	Py_DECREF(file_type_str);
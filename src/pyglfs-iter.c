@@ -167,7 +167,8 @@ int iter_glfs_object_handle(py_glfs_obj_t *root, glfs_object_cb_t *cb)
 		);
 
 		if (rv == -1) {
-			break;
+			/* don't let the EOF check below mask the error */
+			return -1;
 		}
 
 		if (entry == NULL) {
@@ -0,0 +1,351 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Lease-backed read cache for a single FD.
+ *
+ * A read lease is acquired when the FD is opened. While it is held no
+ * other client may modify the file, and so data read through the FD is
+ * kept in fixed size pages and subsequent reads are served from memory.
+ * When the servers recall the lease (another client opens the file for
+ * writing) the pages are dropped from the recall callback and later
+ * reads go to the servers. The recall callback runs in a gfapi thread
+ * and must not issue fops, so the lease is released by a job on the
+ * reaper thread, which holds a reference to the cache until it has
+ * run. If the job can't be queued the lease is released on the next
+ * read or when the FD is closed.
+ *
+ * Pages are filled without holding the lock so that a recall is never
+ * blocked behind network I/O. A generation counter prevents pages read
+ * before a recall from being added to the cache after it.
+ */
+
+#define LEASE_PAGE_SIZE	(64 * 1024)
+
+typedef struct {
+	size_t len;	/* short page marks EOF */
+	char data[];
+} lease_page_t;
+
+struct pyglfs_lease_cache {
+	glfs_fd_t *fd;
+	glfs_leaseid_t lease_id;
+	pthread_mutex_t lock;
+	pthread_cond_t released;
+	size_t refs;		/* FD and queued release job */
+	bool held;		/* lease granted and not recalled */
+	bool locked;		/* lease needs to be released */
+	bool releasing;		/* unlock fop in progress */
+	uint64_t gen;
+	size_t npages;
+	lease_page_t **pages;
+	size_t bytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t recalls;
+};
+
+static void lease_drop_pages(pyglfs_lease_cache_t *lc)
+{
+	size_t i;
+
+	for (i = 0; i < lc->npages; i++) {
+		free(lc->pages[i]);
+		lc->pages[i] = NULL;
+	}
+	lc->bytes = 0;
+	lc->gen++;
+}
+
+static void lease_release(pyglfs_lease_cache_t *lc)
+{
+	glfs_lease_t lease = {
+		.cmd = GLFS_UNLK_LEASE,
+		.lease_type = GLFS_RD_LEASE,
+	};
+	bool locked;
+
+	pthread_mutex_lock(&lc->lock);
+	locked = lc->locked;
+	lc->locked = false;
+	lc->held = false;
+	lc->releasing |= locked;
+	pthread_mutex_unlock(&lc->lock);
+
+	if (!locked) {
+		return;
+	}
+
+	memcpy(lease.lease_id, lc->lease_id, GLFS_LEASE_ID_SIZE);
+	if (glfs_lease(lc->fd, &lease, NULL, NULL) == -1) {
+		fprintf(stderr, "glfs_lease() unlock failed: %s\n",
+			strerror(errno));
+	}
+
+	pthread_mutex_lock(&lc->lock);
+	lc->releasing = false;
+	pthread_cond_broadcast(&lc->released);
+	pthread_mutex_unlock(&lc->lock);
+}
+
+static void lease_cache_put(pyglfs_lease_cache_t *lc)
+{
+	bool last;
+
+	pthread_mutex_lock(&lc->lock);
+	last = (--lc->refs == 0);
+	pthread_mutex_unlock(&lc->lock);
+
+	if (!last) {
+		return;
+	}
+
+	lease_drop_pages(lc);
+	pthread_cond_destroy(&lc->released);
+	pthread_mutex_destroy(&lc->lock);
+	free(lc->pages);
+	free(lc);
+}
+
+static void lease_release_job(void *data)
+{
+	pyglfs_lease_cache_t *lc = (pyglfs_lease_cache_t *)data;
+
+	lease_release(lc);
+	lease_cache_put(lc);
+}
+
+static void lease_recall_cbk(glfs_lease_t lease, void *data)
+{
+	pyglfs_lease_cache_t *lc = (pyglfs_lease_cache_t *)data;
+	bool queue;
+
+	pthread_mutex_lock(&lc->lock);
+	lc->held = false;
+	lc->recalls++;
+	lease_drop_pages(lc);
+	queue = lc->locked;
+	if (queue) {
+		lc->refs++;
+	}
+	pthread_mutex_unlock(&lc->lock);
+
+	/* conflicting client waits until the lease is released */
+	if (queue && !pyglfs_reaper_queue_job(lease_release_job, lc)) {
+		lease_cache_put(lc);
+	}
+}
+
+/*
+ * Acquire read lease on fd and set up page cache of at most
+ * max_bytes. fd must have been opened with lease_id set via
+ * glfs_setfsleaseid(). Called without the GIL. Returns NULL
+ * with errno set on failure.
+ */
+pyglfs_lease_cache_t *pyglfs_lease_cache_new(glfs_fd_t *fd,
+					     const char *lease_id,
+					     size_t max_bytes)
+{
+	pyglfs_lease_cache_t *lc = NULL;
+	glfs_lease_t lease = {
+		.cmd = GLFS_SET_LEASE,
+		.lease_type = GLFS_RD_LEASE,
+	};
+
+	lc = calloc(1, sizeof(pyglfs_lease_cache_t));
+	if (lc == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	lc->npages = (max_bytes + LEASE_PAGE_SIZE - 1) / LEASE_PAGE_SIZE;
+	lc->pages = calloc(lc->npages, sizeof(lease_page_t *));
+	if (lc->pages == NULL) {
+		free(lc);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	lc->fd = fd;
+	memcpy(lc->lease_id, lease_id, GLFS_LEASE_ID_SIZE);
+	memcpy(lease.lease_id, lease_id, GLFS_LEASE_ID_SIZE);
+	pthread_mutex_init(&lc->lock, NULL);
+	pthread_cond_init(&lc->released, NULL);
+	lc->refs = 1;
+
+	if (glfs_lease(fd, &lease, lease_recall_cbk, lc) == -1) {
+		int err = errno;
+		pthread_cond_destroy(&lc->released);
+		pthread_mutex_destroy(&lc->lock);
+		free(lc->pages);
+		free(lc);
+		errno = err;
+		return NULL;
+	}
+
+	lc->held = lc->locked = true;
+	return lc;
+}
+
+/*
+ * Release lease and free cache. Must be called before fd is closed.
+ * Waits for a release in progress on the reaper thread, as the fd
+ * must stay open until it completes.
+ */
+void pyglfs_lease_cache_free(pyglfs_lease_cache_t *lc)
+{
+	if (lc == NULL) {
+		return;
+	}
+
+	lease_release(lc);
+
+	pthread_mutex_lock(&lc->lock);
+	while (lc->releasing) {
+		pthread_cond_wait(&lc->released, &lc->lock);
+	}
+	pthread_mutex_unlock(&lc->lock);
+
+	lease_cache_put(lc);
+}
+
+/*
+ * Drop cached pages after write through the FD.
+ */
+void pyglfs_lease_cache_invalidate(pyglfs_lease_cache_t *lc)
+{
+	if (lc == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&lc->lock);
+	lease_drop_pages(lc);
+	pthread_mutex_unlock(&lc->lock);
+}
+
+/*
+ * pread() equivalent that is served from cached pages while the lease
+ * is held. Called without the GIL.
+ */
+ssize_t pyglfs_lease_cache_pread(pyglfs_lease_cache_t *lc,
+				 char *buf, size_t cnt, off_t offset)
+{
+	size_t done = 0;
+
+	pthread_mutex_lock(&lc->lock);
+	if (!lc->held ||
+	    ((size_t)offset + cnt > lc->npages * LEASE_PAGE_SIZE)) {
+		bool release = lc->locked && !lc->held;
+
+		lc->misses++;
+		pthread_mutex_unlock(&lc->lock);
+
+		if (release) {
+			lease_release(lc);
+		}
+		return glfs_pread(lc->fd, buf, cnt, offset, 0, NULL);
+	}
+
+	while (done < cnt) {
+		size_t pos = offset + done;
+		size_t idx = pos / LEASE_PAGE_SIZE;
+		size_t poff = pos % LEASE_PAGE_SIZE;
+		lease_page_t *page = lc->pages[idx];
+		bool owned = false, eof;
+		size_t len;
+
+		if (page == NULL) {
+			uint64_t gen = lc->gen;
+			ssize_t n;
+
+			lc->misses++;
+			pthread_mutex_unlock(&lc->lock);
+
+			page = malloc(sizeof(lease_page_t) + LEASE_PAGE_SIZE);
+			if (page == NULL) {
+				errno = ENOMEM;
+				return -1;
+			}
+
+			n = glfs_pread(lc->fd, page->data, LEASE_PAGE_SIZE,
+				       idx * LEASE_PAGE_SIZE, 0, NULL);
+			if (n == -1) {
+				free(page);
+				return -1;
+			}
+			page->len = n;
+
+			pthread_mutex_lock(&lc->lock);
+			if ((gen == lc->gen) && lc->held &&
+			    (lc->pages[idx] == NULL)) {
+				lc->pages[idx] = page;
+				lc->bytes += LEASE_PAGE_SIZE;
+			} else {
+				/* recalled or raced, use for this read only */
+				owned = true;
+			}
+		} else {
+			lc->hits++;
+		}
+
+		len = (page->len > poff) ? page->len - poff : 0;
+		len = Py_MIN(len, cnt - done);
+		memcpy(buf + done, page->data + poff, len);
+		done += len;
+		eof = (page->len < LEASE_PAGE_SIZE) && (poff + len >= page->len);
+
+		if (owned) {
+			free(page);
+		}
+
+		if (eof) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lc->lock);
+
+	return done;
+}
+
+PyObject *pyglfs_lease_cache_stats_to_dict(pyglfs_lease_cache_t *lc)
+{
+	PyObject *out = NULL;
+
+	if (lc == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	pthread_mutex_lock(&lc->lock);
+	out = Py_BuildValue(
+		"{s:O,s:K,s:K,s:K,s:n}",
+		"held", lc->held ? Py_True : Py_False,
+		"hits", (unsigned long long)lc->hits,
+		"misses", (unsigned long long)lc->misses,
+		"recalls", (unsigned long long)lc->recalls,
+		"bytes", (Py_ssize_t)lc->bytes
+	);
+	pthread_mutex_unlock(&lc->lock);
+
+	return out;
+}
@@ -0,0 +1,557 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Performance profiles.
+ *
+ * A profile is a named set of client-side xlator options, applied with
+ * glfs_set_xlator_option() before the xlators passed by the caller, so
+ * that explicit options take precedence. Options for xlators that are
+ * not part of the client graph of the volume have no effect.
+ */
+
+typedef struct {
+	const char *xlator;
+	const char *key;
+	const char *value;
+} profile_opt_t;
+
+struct pyglfs_profile {
+	const char *name;
+	const char *doc;
+	const profile_opt_t *opts;
+};
+
+static const profile_opt_t metadata_heavy_opts[] = {
+	{ "*-md-cache", "md-cache-timeout", "600" },
+	{ "*-md-cache", "cache-invalidation", "on" },
+	{ "*-md-cache", "force-readdirp", "true" },
+	{ "*-readdir-ahead", "rda-cache-limit", "32MB" },
+	{ "*-dht", "lookup-optimize", "on" },
+	{ NULL, NULL, NULL }
+};
+
+static const profile_opt_t streaming_read_opts[] = {
+	{ "*-read-ahead", "page-count", "16" },
+	{ "*-io-cache", "cache-size", "256MB" },
+	{ "*-md-cache", "md-cache-timeout", "60" },
+	{ "*-client-*", "event-threads", "4" },
+	{ NULL, NULL, NULL }
+};
+
+static const profile_opt_t small_file_write_opts[] = {
+	{ "*-write-behind", "cache-size", "4MB" },
+	{ "*-write-behind", "flush-behind", "on" },
+	{ "*-write-behind", "trickling-writes", "on" },
+	{ "*-open-behind", "lazy-open", "yes" },
+	{ "*-md-cache", "md-cache-timeout", "60" },
+	{ NULL, NULL, NULL }
+};
+
+static const profile_opt_t scan_opts[] = {
+	{ "*-readdir-ahead", "rda-request-size", "131072" },
+	{ "*-readdir-ahead", "rda-cache-limit", "64MB" },
+	{ "*-md-cache", "md-cache-timeout", "60" },
+	{ "*-md-cache", "force-readdirp", "true" },
+	{ "*-client-*", "event-threads", "4" },
+	{ NULL, NULL, NULL }
+};
+
+static const pyglfs_profile_t profiles[] = {
+	{
+		.name = "metadata-heavy",
+		.doc = "Long-lived stat and xattr caching for lookup and "
+		       "stat dominated workloads.",
+		.opts = metadata_heavy_opts,
+	},
+	{
+		.name = "streaming-read",
+		.doc = "Deep read-ahead and large io-cache for sequential "
+		       "reads of large files.",
+		.opts = streaming_read_opts,
+	},
+	{
+		.name = "small-file-write",
+		.doc = "Aggressive write-behind and lazy open for creating "
+		       "and writing many small files.",
+		.opts = small_file_write_opts,
+	},
+	{
+		.name = "scan",
+		.doc = "Large readdir-ahead buffers and readdirplus for "
+		       "directory tree traversal.",
+		.opts = scan_opts,
+	},
+	{ .name = NULL }
+};
+
+const pyglfs_profile_t *pyglfs_profile_lookup(const char *name)
+{
+	const pyglfs_profile_t *p = NULL;
+
+	for (p = profiles; p->name != NULL; p++) {
+		if (strcmp(p->name, name) == 0) {
+			return p;
+		}
+	}
+
+	PyErr_Format(PyExc_ValueError, "%s: unknown profile.", name);
+	return NULL;
+}
+
+const char *pyglfs_profile_name(const pyglfs_profile_t *profile)
+{
+	return profile->name;
+}
+
+bool pyglfs_profile_apply(const pyglfs_profile_t *profile, glfs_t *fs)
+{
+	const profile_opt_t *opt = NULL;
+
+	for (opt = profile->opts; opt->xlator != NULL; opt++) {
+		if (glfs_set_xlator_option(fs, opt->xlator, opt->key,
+					   opt->value)) {
+			PyErr_Format(
+				PyExc_RuntimeError,
+				"set_xlator_option() failed: %s. Profile: %s, "
+				"xlator - %s, key - %s, value - %s",
+				strerror(errno), profile->name,
+				opt->xlator, opt->key, opt->value
+			);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Build dict of profile name to (description, options) for the
+ * module-level PROFILES constant.
+ */
+PyObject *pyglfs_profiles_to_dict(void)
+{
+	const pyglfs_profile_t *p = NULL;
+	const profile_opt_t *opt = NULL;
+	PyObject *out = NULL;
+
+	out = PyDict_New();
+	if (out == NULL) {
+		return NULL;
+	}
+
+	for (p = profiles; p->name != NULL; p++) {
+		PyObject *opts = NULL, *entry = NULL;
+		int err;
+
+		opts = PyList_New(0);
+		if (opts == NULL) {
+			Py_DECREF(out);
+			return NULL;
+		}
+
+		for (opt = p->opts; opt->xlator != NULL; opt++) {
+			PyObject *t = Py_BuildValue("(sss)", opt->xlator,
+						    opt->key, opt->value);
+			if ((t == NULL) || (PyList_Append(opts, t) == -1)) {
+				Py_XDECREF(t);
+				Py_DECREF(opts);
+				Py_DECREF(out);
+				return NULL;
+			}
+			Py_DECREF(t);
+		}
+
+		entry = Py_BuildValue("(sN)", p->doc, opts);
+		if (entry == NULL) {
+			Py_DECREF(out);
+			return NULL;
+		}
+
+		err = PyDict_SetItemString(out, p->name, entry);
+		Py_DECREF(entry);
+		if (err == -1) {
+			Py_DECREF(out);
+			return NULL;
+		}
+	}
+
+	return out;
+}
+
+/*
+ * Benchmark workloads. Each runs against `path` on a freshly connected
+ * context without the GIL and returns 0 or -1 with errno set.
+ */
+
+#define BENCH_READ_SIZE		(1024 * 1024)
+#define BENCH_WRITE_FILES	64
+#define BENCH_WRITE_SIZE	4096
+
+typedef int (*bench_fn_t)(glfs_t *fs, glfs_object_t *obj);
+
+/* lookup and stat every entry of directory */
+static int bench_metadata(glfs_t *fs, glfs_object_t *dir)
+{
+	struct dirent de, *result = NULL;
+	glfs_fd_t *fd = NULL;
+	int err = 0;
+
+	fd = glfs_h_opendir(fs, dir);
+	if (fd == NULL) {
+		return -1;
+	}
+
+	for (;;) {
+		glfs_object_t *obj = NULL;
+		struct stat st;
+
+		if (glfs_readdir_r(fd, &de, &result) != 0) {
+			err = -1;
+			break;
+		}
+
+		if (result == NULL) {
+			break;
+		}
+
+		if ((strcmp(result->d_name, ".") == 0) ||
+		    (strcmp(result->d_name, "..") == 0)) {
+			continue;
+		}
+
+		obj = glfs_h_lookupat(fs, dir, result->d_name, &st, 0);
+		if (obj == NULL) {
+			if (errno == ENOENT) {
+				continue;
+			}
+			err = -1;
+			break;
+		}
+		glfs_h_close(obj);
+	}
+
+	glfs_closedir(fd);
+	return err;
+}
+
+/* read directory with stat of entries */
+static int bench_scan(glfs_t *fs, glfs_object_t *dir)
+{
+	struct dirent de, *result = NULL;
+	glfs_fd_t *fd = NULL;
+	int err = 0;
+
+	fd = glfs_h_opendir(fs, dir);
+	if (fd == NULL) {
+		return -1;
+	}
+
+	for (;;) {
+		glfs_xreaddirp_stat_t *xstat = NULL;
+
+		if (glfs_xreaddirplus_r(fd, GFAPI_XREADDIRP_STAT, &xstat,
+					&de, &result) == -1) {
+			err = -1;
+			break;
+		}
+
+		if (xstat != NULL) {
+			glfs_free(xstat);
+		}
+
+		if (result == NULL) {
+			break;
+		}
+	}
+
+	glfs_closedir(fd);
+	return err;
+}
+
+/* read file sequentially to EOF */
+static int bench_streaming_read(glfs_t *fs, glfs_object_t *file)
+{
+	glfs_fd_t *fd = NULL;
+	char *buf = NULL;
+	off_t off = 0;
+	ssize_t n;
+
+	buf = malloc(BENCH_READ_SIZE);
+	if (buf == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	fd = glfs_h_open(fs, file, O_RDONLY);
+	if (fd == NULL) {
+		free(buf);
+		return -1;
+	}
+
+	do {
+		n = glfs_pread(fd, buf, BENCH_READ_SIZE, off, 0, NULL);
+		off += (n > 0) ? n : 0;
+	} while (n > 0);
+
+	glfs_close(fd);
+	free(buf);
+	return (n == -1) ? -1 : 0;
+}
+
+/* create, write and remove small files in directory */
+static int bench_small_file_write(glfs_t *fs, glfs_object_t *dir)
+{
+	char buf[BENCH_WRITE_SIZE];
+	char name[NAME_MAX + 1];
+	int i, err = 0;
+
+	memset(buf, 0x5a, sizeof(buf));
+
+	for (i = 0; (i < BENCH_WRITE_FILES) && (err == 0); i++) {
+		glfs_object_t *obj = NULL;
+		glfs_fd_t *fd = NULL;
+		struct stat st;
+
+		snprintf(name, sizeof(name), ".pyglfs-bench-%d-%d",
+			 getpid(), i);
+
+		obj = glfs_h_creat(fs, dir, name, O_WRONLY | O_TRUNC,
+				   0600, &st);
+		if (obj == NULL) {
+			return -1;
+		}
+
+		fd = glfs_h_open(fs, obj, O_WRONLY);
+		if ((fd == NULL) ||
+		    (glfs_pwrite(fd, buf, sizeof(buf), 0, 0,
+				 NULL, NULL) == -1)) {
+			err = -1;
+		}
+
+		if ((fd != NULL) && (glfs_close(fd) == -1)) {
+			err = -1;
+		}
+
+		glfs_h_close(obj);
+		glfs_h_unlink(fs, dir, name);
+	}
+
+	return err;
+}
+
+static const struct {
+	const char *name;
+	bench_fn_t fn;
+	bool is_dir;
+} workloads[] = {
+	{ "metadata-heavy", bench_metadata, true },
+	{ "streaming-read", bench_streaming_read, false },
+	{ "small-file-write", bench_small_file_write, true },
+	{ "scan", bench_scan, true },
+	{ NULL, NULL, false }
+};
+
+/*
+ * Connect a new private Volume with the parameters of `self` and the
+ * given profile (NULL for none).
+ */
+static py_glfs_t *bench_volume(py_glfs_t *self, const char *profile)
+{
+	PyObject *kwargs = NULL, *args = NULL, *vol = NULL;
+	PyObject *servers = NULL, *xlators = NULL;
+
+	servers = PyObject_GetAttrString((PyObject *)self, "volfile_servers");
+	xlators = PyObject_GetAttrString((PyObject *)self, "xlators");
+	if ((servers == NULL) || (xlators == NULL)) {
+		goto out;
+	}
+
+	args = Py_BuildValue("(sO)", self->name, servers);
+	if (args == NULL) {
+		goto out;
+	}
+
+	kwargs = Py_BuildValue("{s:i,s:O,s:O,s:z}",
+			       "log_level", self->log_level,
+			       "shared", Py_False,
+			       "background_fini", Py_False,
+			       "profile", profile);
+	if (kwargs == NULL) {
+		goto out;
+	}
+
+	if ((xlators != Py_None) &&
+	    (PyDict_SetItemString(kwargs, "xlators", xlators) == -1)) {
+		goto out;
+	}
+
+	if (self->log_file[0] != '\0') {
+		PyObject *log_file = PyUnicode_FromString(self->log_file);
+		if ((log_file == NULL) ||
+		    (PyDict_SetItemString(kwargs, "log_file", log_file) == -1)) {
+			Py_XDECREF(log_file);
+			goto out;
+		}
+		Py_DECREF(log_file);
+	}
+
+	vol = PyObject_Call((PyObject *)&PyGlfsVolume, args, kwargs);
+
+out:
+	Py_XDECREF(servers);
+	Py_XDECREF(xlators);
+	Py_XDECREF(args);
+	Py_XDECREF(kwargs);
+	return (py_glfs_t *)vol;
+}
+
+/*
+ * Run workload `iterations` times on a new context with the given
+ * profile. Returns elapsed seconds or -1 with exception set.
+ */
+static double bench_profile(py_glfs_t *self, const char *profile,
+			    const char *path, bench_fn_t fn, bool is_dir,
+			    int iterations)
+{
+	PyObject *close_res = NULL;
+	glfs_object_t *obj = NULL;
+	py_glfs_t *vol = NULL;
+	struct stat st;
+	uint64_t start = 0, end = 0;
+	int i, err = 0;
+
+	vol = bench_volume(self, profile);
+	if (vol == NULL) {
+		return -1;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	obj = glfs_h_lookupat(vol->fs, NULL, path, &st, 1);
+	if ((obj != NULL) && (S_ISDIR(st.st_mode) != is_dir)) {
+		glfs_h_close(obj);
+		obj = NULL;
+		errno = is_dir ? ENOTDIR : EISDIR;
+	}
+
+	if (obj != NULL) {
+		start = pyglfs_now_ns();
+		for (i = 0; (i < iterations) && (err == 0); i++) {
+			err = fn(vol->fs, obj);
+		}
+		end = pyglfs_now_ns();
+		glfs_h_close(obj);
+	}
+	Py_END_ALLOW_THREADS
+
+	if ((obj == NULL) || (err == -1)) {
+		set_glfs_exc(obj == NULL ? "glfs_h_lookupat()" : "benchmark");
+		Py_DECREF(vol);
+		return -1;
+	}
+
+	close_res = PyObject_CallMethod((PyObject *)vol, "close", NULL);
+	Py_XDECREF(close_res);
+	Py_DECREF(vol);
+	if (close_res == NULL) {
+		return -1;
+	}
+
+	return (double)(end - start) / 1000000000.0;
+}
+
+PyObject *pyglfs_profile_benchmark(py_glfs_t *self, const char *path,
+				   const char *workload, int iterations)
+{
+	PyObject *results = NULL, *res = NULL;
+	const char *best = NULL;
+	double best_time = 0;
+	ssize_t i;
+	size_t w;
+
+	for (w = 0; workloads[w].name != NULL; w++) {
+		if (strcmp(workloads[w].name, workload) == 0) {
+			break;
+		}
+	}
+
+	if (workloads[w].name == NULL) {
+		PyErr_Format(PyExc_ValueError, "%s: unknown workload.",
+			     workload);
+		return NULL;
+	}
+
+	if (iterations < 1) {
+		PyErr_SetString(PyExc_ValueError,
+				"iterations must be at least one.");
+		return NULL;
+	}
+
+	results = PyDict_New();
+	if (results == NULL) {
+		return NULL;
+	}
+
+	/* first run is the baseline without profile */
+	for (i = -1; (i == -1) || (profiles[i].name != NULL); i++) {
+		const char *name = (i == -1) ? NULL : profiles[i].name;
+		PyObject *elapsed = NULL;
+		double t;
+		int err;
+
+		t = bench_profile(self, name, path, workloads[w].fn,
+				  workloads[w].is_dir, iterations);
+		if (t < 0) {
+			Py_DECREF(results);
+			return NULL;
+		}
+
+		elapsed = PyFloat_FromDouble(t);
+		if (elapsed == NULL) {
+			Py_DECREF(results);
+			return NULL;
+		}
+
+		err = PyDict_SetItemString(results,
+					   name ? name : "default", elapsed);
+		Py_DECREF(elapsed);
+		if (err == -1) {
+			Py_DECREF(results);
+			return NULL;
+		}
+
+		if ((best == NULL) || (t < best_time)) {
+			best = name ? name : "default";
+			best_time = t;
+		}
+	}
+
+	res = Py_BuildValue("{s:s,s:i,s:N,s:s}",
+			    "workload", workload,
+			    "iterations", iterations,
+			    "results", results,
+			    "best", best);
+	return res;
+}
@@ -0,0 +1,202 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include <time.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Background finalization of glfs_t contexts.
+ *
+ * glfs_fini() tears down the client graph and its threads, which
+ * commonly takes seconds. Contexts released by Volumes are queued
+ * to a single native reaper thread, started on first use, so that
+ * the thread dropping the last reference does not stall. drain()
+ * waits for the queue to empty and is also run at interpreter exit.
+ *
+ * The thread also runs other deferred jobs that must issue fops but are
+ * triggered from gfapi callback threads, such as releasing a recalled
+ * lease. These are queued behind pending finalizations.
+ */
+
+typedef struct reap_entry {
+	glfs_t *fs;
+	pyglfs_upcall_t *upcall;
+	pyglfs_reaper_fn_t fn;		/* job instead of fs if set */
+	void *data;
+	struct reap_entry *next;
+} reap_entry_t;
+
+static pthread_mutex_t reap_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reap_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t reap_idle = PTHREAD_COND_INITIALIZER;
+static reap_entry_t *reap_head;
+static reap_entry_t **reap_tail = &reap_head;
+static size_t reap_pending;	/* queued or being finalized */
+static bool reap_running;
+
+static void *reaper_thread(void *data)
+{
+	reap_entry_t *ent = NULL;
+
+	pthread_mutex_lock(&reap_lock);
+	for (;;) {
+		while (reap_head == NULL) {
+			pthread_cond_wait(&reap_work, &reap_lock);
+		}
+
+		ent = reap_head;
+		reap_head = ent->next;
+		if (reap_head == NULL) {
+			reap_tail = &reap_head;
+		}
+		pthread_mutex_unlock(&reap_lock);
+
+		if (ent->fn != NULL) {
+			ent->fn(ent->data);
+		} else {
+			pyglfs_upcall_free(ent->upcall);
+			glfs_fini(ent->fs);
+		}
+		free(ent);
+
+		pthread_mutex_lock(&reap_lock);
+		if (--reap_pending == 0) {
+			pthread_cond_broadcast(&reap_idle);
+		}
+	}
+
+	return NULL;
+}
+
+/* start reaper on first use and append ent, which is freed on failure */
+static bool reaper_push(reap_entry_t *ent)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	int err;
+
+	pthread_mutex_lock(&reap_lock);
+	if (!reap_running) {
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		err = pthread_create(&thread, &attr, reaper_thread, NULL);
+		pthread_attr_destroy(&attr);
+		if (err) {
+			pthread_mutex_unlock(&reap_lock);
+			free(ent);
+			return false;
+		}
+		reap_running = true;
+	}
+
+	*reap_tail = ent;
+	reap_tail = &ent->next;
+	reap_pending++;
+	pthread_cond_signal(&reap_work);
+	pthread_mutex_unlock(&reap_lock);
+
+	return true;
+}
+
+/*
+ * Queue glfs_t and its upcall dispatcher (may be NULL) for
+ * finalization. Returns false if the reaper could not be started, in
+ * which case the caller must finalize them itself. May be called
+ * without the GIL.
+ */
+bool pyglfs_reaper_queue(glfs_t *fs, pyglfs_upcall_t *upcall)
+{
+	reap_entry_t *ent = NULL;
+
+	ent = calloc(1, sizeof(reap_entry_t));
+	if (ent == NULL) {
+		return false;
+	}
+	ent->fs = fs;
+	ent->upcall = upcall;
+
+	return reaper_push(ent);
+}
+
+/*
+ * Queue fn(data) to run on the reaper thread. Returns false if it
+ * could not be queued. May be called without the GIL, including from
+ * gfapi callback threads.
+ */
+bool pyglfs_reaper_queue_job(pyglfs_reaper_fn_t fn, void *data)
+{
+	reap_entry_t *ent = NULL;
+
+	ent = calloc(1, sizeof(reap_entry_t));
+	if (ent == NULL) {
+		return false;
+	}
+	ent->fn = fn;
+	ent->data = data;
+
+	return reaper_push(ent);
+}
+
+/*
+ * Wait up to `timeout` seconds, or indefinitely if negative, until all
+ * queued contexts are finalized. Returns false on timeout. Called
+ * without the GIL.
+ */
+bool pyglfs_reaper_drain(double timeout)
+{
+	struct timespec ts;
+	bool idle;
+	int err = 0;
+
+	if (timeout >= 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += (time_t)timeout;
+		ts.tv_nsec += (long)((timeout - (time_t)timeout) * 1000000000.0);
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&reap_lock);
+	while ((reap_pending > 0) && (err != ETIMEDOUT)) {
+		if (timeout < 0) {
+			pthread_cond_wait(&reap_idle, &reap_lock);
+		} else {
+			err = pthread_cond_timedwait(&reap_idle, &reap_lock, &ts);
+		}
+	}
+	idle = (reap_pending == 0);
+	pthread_mutex_unlock(&reap_lock);
+
+	return idle;
+}
+
+static void reaper_atexit(void)
+{
+	pyglfs_reaper_drain(-1);
+}
+
+bool pyglfs_reaper_init(void)
+{
+	return Py_AtExit(reaper_atexit) == 0;
+}
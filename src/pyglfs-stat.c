@@ -17,46 +17,179 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include <Python.h>
 #include "includes.h"
 #include "pyglfs.h"
 
-PyObject *os_module;
+static PyStructSequence_Field stat_result_fields[] = {
+	{ "st_mode", "protection bits" },
+	{ "st_ino", "inode" },
+	{ "st_dev", "device" },
+	{ "st_nlink", "number of hard links" },
+	{ "st_uid", "user ID of owner" },
+	{ "st_gid", "group ID of owner" },
+	{ "st_size", "total size, in bytes" },
+	/*
+	 * Integer times for tuple compatibility with os.stat_result. Names
+	 * are set to PyStructSequence_UnnamedField in init_pystat_type(), as
+	 * it is not a constant expression; NULL would end the field list.
+	 */
+#define STAT_FIRST_UNNAMED 7
+	{ NULL, "integer time of last access" },
+	{ NULL, "integer time of last modification" },
+	{ NULL, "integer time of last change" },
+	{ "st_atime", "time of last access" },
+	{ "st_mtime", "time of last modification" },
+	{ "st_ctime", "time of last change" },
+	{ "st_atime_ns", "time of last access in nanoseconds" },
+	{ "st_mtime_ns", "time of last modification in nanoseconds" },
+	{ "st_ctime_ns", "time of last change in nanoseconds" },
+	{ "st_blksize", "blocksize for filesystem I/O" },
+	{ "st_blocks", "number of 512-byte blocks allocated" },
+	{ "st_rdev", "device type (if inode device)" },
+	{ NULL, NULL }
+};
 
-PyObject *stat_to_pystat(struct stat *st)
+PyDoc_STRVAR(stat_result__doc__,
+"stat_result: Result from stat() of a gluster object.\n\n"
+"Same layout as os.stat_result. The first ten items may be accessed as\n"
+"a tuple, and all fields are available as attributes, including\n"
+"nanosecond timestamps, st_blksize, st_blocks and st_rdev.\n"
+);
+
+static PyStructSequence_Desc stat_result_desc = {
+	.name = "pyglfs.stat_result",
+	.doc = stat_result__doc__,
+	.fields = stat_result_fields,
+	.n_in_sequence = 10,
+};
+
+PyTypeObject PyGlfsStatResult;
+
+static int64_t timespec_to_ns(const struct timespec *ts)
+{
+	return (ts->tv_sec * 1000000000LL) + ts->tv_nsec;
+}
+
+static void ns_to_timespec(int64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000LL;
+	ts->tv_nsec = ns % 1000000000LL;
+	if (ts->tv_nsec < 0) {
+		ts->tv_sec--;
+		ts->tv_nsec += 1000000000LL;
+	}
+}
+
+void pyglfs_stat_pack(pyglfs_stat_t *dst, const struct stat *st)
+{
+	*dst = (pyglfs_stat_t) {
+		.st_ino = st->st_ino,
+		.st_dev = st->st_dev,
+		.st_rdev = st->st_rdev,
+		.st_size = st->st_size,
+		.st_blocks = st->st_blocks,
+		.st_atime_ns = timespec_to_ns(&st->st_atim),
+		.st_mtime_ns = timespec_to_ns(&st->st_mtim),
+		.st_ctime_ns = timespec_to_ns(&st->st_ctim),
+		.st_mode = st->st_mode,
+		.st_nlink = st->st_nlink,
+		.st_uid = st->st_uid,
+		.st_gid = st->st_gid,
+		.st_blksize = st->st_blksize,
+		.valid = true,
+	};
+}
+
+void pyglfs_stat_unpack(const pyglfs_stat_t *src, struct stat *st)
+{
+	memset(st, 0, sizeof(struct stat));
+	st->st_ino = src->st_ino;
+	st->st_dev = src->st_dev;
+	st->st_rdev = src->st_rdev;
+	st->st_size = src->st_size;
+	st->st_blocks = src->st_blocks;
+	ns_to_timespec(src->st_atime_ns, &st->st_atim);
+	ns_to_timespec(src->st_mtime_ns, &st->st_mtim);
+	ns_to_timespec(src->st_ctime_ns, &st->st_ctim);
+	st->st_mode = src->st_mode;
+	st->st_nlink = src->st_nlink;
+	st->st_uid = src->st_uid;
+	st->st_gid = src->st_gid;
+	st->st_blksize = src->st_blksize;
+}
+
+PyObject *compact_stat_to_pystat(const pyglfs_stat_t *src)
 {
 	PyObject *out = NULL;
 	PyObject *v = NULL;
+	int64_t times[] = { src->st_atime_ns, src->st_mtime_ns, src->st_ctime_ns };
+	Py_ssize_t i = 0;
+	size_t t;
 
-	v = Py_BuildValue(
-		"(lkklkkLLLL)",
-		(long)st->st_mode,
-		st->st_ino,
-		st->st_dev,
-		st->st_nlink,
-		st->st_uid,
-		st->st_gid,
-		st->st_size,
-		st->st_atime,
-		st->st_mtime,
-		st->st_ctime
-	);
-
-	if (v == NULL) {
+	out = PyStructSequence_New(&PyGlfsStatResult);
+	if (out == NULL) {
 		return NULL;
 	}
 
-	out = PyObject_CallMethod(os_module, "stat_result", "(O)", v);
-	Py_DECREF(v);
+#define SET_ITEM(expr) do { \
+	if ((v = (expr)) == NULL) { \
+		Py_DECREF(out); \
+		return NULL; \
+	} \
+	PyStructSequence_SET_ITEM(out, i++, v); \
+} while (0)
+
+	SET_ITEM(PyLong_FromUnsignedLong(src->st_mode));
+	SET_ITEM(PyLong_FromUnsignedLongLong(src->st_ino));
+	SET_ITEM(PyLong_FromUnsignedLongLong(src->st_dev));
+	SET_ITEM(PyLong_FromUnsignedLong(src->st_nlink));
+	SET_ITEM(PyLong_FromUnsignedLong(src->st_uid));
+	SET_ITEM(PyLong_FromUnsignedLong(src->st_gid));
+	SET_ITEM(PyLong_FromLongLong(src->st_size));
+
+	for (t = 0; t < 3; t++) {
+		struct timespec ts;
+
+		ns_to_timespec(times[t], &ts);
+		SET_ITEM(PyLong_FromLongLong(ts.tv_sec));
+	}
+	for (t = 0; t < 3; t++) {
+		SET_ITEM(PyFloat_FromDouble(times[t] * 1e-9));
+	}
+	for (t = 0; t < 3; t++) {
+		SET_ITEM(PyLong_FromLongLong(times[t]));
+	}
+
+	SET_ITEM(PyLong_FromUnsignedLong(src->st_blksize));
+	SET_ITEM(PyLong_FromLongLong(src->st_blocks));
+	SET_ITEM(PyLong_FromUnsignedLongLong(src->st_rdev));
+#undef SET_ITEM
 
 	return out;
 }
 
+PyObject *stat_to_pystat(struct stat *st)
+{
+	pyglfs_stat_t cst;
+
+	pyglfs_stat_pack(&cst, st);
+	return compact_stat_to_pystat(&cst);
+}
+
 bool init_pystat_type(void)
 {
-	if (os_module != NULL) {
-		Py_INCREF(os_module);
+	size_t i;
+
+	if (PyGlfsStatResult.tp_name != NULL) {
+		return true;
+	}
+
+	for (i = STAT_FIRST_UNNAMED; i < STAT_FIRST_UNNAMED + 3; i++) {
+		stat_result_fields[i].name = PyStructSequence_UnnamedField;
 	}
-	os_module = PyImport_ImportModule("os");
-	return os_module ? true : false;
+
+	return PyStructSequence_InitType2(&PyGlfsStatResult,
+					  &stat_result_desc) == 0;
 }
@@ -0,0 +1,103 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+struct job_state {
+	size_t njobs;
+	size_t next;
+	pyglfs_job_fn_t fn;
+	void *private;
+};
+
+static void *job_worker(void *data)
+{
+	struct job_state *state = (struct job_state *)data;
+	size_t idx;
+
+	for (;;) {
+		idx = __atomic_fetch_add(&state->next, 1, __ATOMIC_RELAXED);
+		if (idx >= state->njobs) {
+			break;
+		}
+		state->fn(idx, state->private);
+	}
+
+	return NULL;
+}
+
+/*
+ * Run `fn` for every index in [0, njobs) using up to `nthreads`
+ * native threads. The calling thread is one of the workers, so
+ * all jobs are completed even if no additional threads could be
+ * started. Jobs must not touch python objects and this should be
+ * called with the GIL released.
+ */
+void pyglfs_run_jobs(size_t njobs, size_t nthreads,
+		     pyglfs_job_fn_t fn, void *private)
+{
+	pthread_t threads[PYGLFS_MAX_JOB_THREADS];
+	size_t i, started = 0;
+	struct job_state state = {
+		.njobs = njobs,
+		.next = 0,
+		.fn = fn,
+		.private = private,
+	};
+
+	if (nthreads > njobs) {
+		nthreads = njobs;
+	}
+
+	if (nthreads > PYGLFS_MAX_JOB_THREADS) {
+		nthreads = PYGLFS_MAX_JOB_THREADS;
+	}
+
+	for (i = 1; i < nthreads; i++) {
+		if (pthread_create(&threads[started], NULL,
+				   job_worker, &state) != 0) {
+			break;
+		}
+		started++;
+	}
+
+	job_worker(&state);
+
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+/* validate user-provided thread count for bulk operations */
+bool pyglfs_check_threads(int threads)
+{
+	if ((threads < 1) || (threads > PYGLFS_MAX_JOB_THREADS)) {
+		PyErr_Format(
+			PyExc_ValueError,
+			"%d: threads must be between 1 and %d.",
+			threads, PYGLFS_MAX_JOB_THREADS
+		);
+		return false;
+	}
+
+	return true;
+}
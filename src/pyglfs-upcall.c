@@ -0,0 +1,325 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Upcall dispatcher.
+ *
+ * libgfapi invokes the registered upcall callback from its own threads.
+ * The callback only copies the gfids out of the upcall into a bounded
+ * queue. A native thread drains the queue and passes events in batches
+ * to subscribers (cache invalidation, watchers). If the queue overflows
+ * events are dropped and subscribers receive a single event with
+ * PYGLFS_UPCALL_OVERFLOW set, after which they should assume that
+ * anything may have changed.
+ *
+ * Subscriber callbacks are called without the GIL.
+ */
+
+#define UPCALL_QUEUE_MAX	4096
+#define UPCALL_BATCH_MAX	256
+
+typedef struct upcall_sub {
+	pyglfs_upcall_fn_t fn;
+	void *private;
+	struct upcall_sub *next;
+} upcall_sub_t;
+
+struct pyglfs_upcall {
+	glfs_t *fs;
+	pthread_t thread;
+	bool thread_started;
+
+	/* protects queue and counters */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pyglfs_upcall_event_t queue[UPCALL_QUEUE_MAX];
+	size_t head;
+	size_t cnt;
+	bool overflow;
+	bool stop;
+	uint64_t events;
+	uint64_t overflows;
+
+	/* held while dispatching so unsubscribe waits for callbacks */
+	pthread_mutex_t sub_lock;
+	upcall_sub_t *subs;
+};
+
+static void extract_gfid(glfs_object_t *obj, unsigned char *gfid)
+{
+	if ((obj == NULL) ||
+	    (glfs_h_extract_handle(obj, gfid, sizeof(uuid_t)) == -1)) {
+		uuid_clear(gfid);
+	}
+}
+
+static void upcall_cbk(struct glfs_upcall *up_arg, void *data)
+{
+	pyglfs_upcall_t *up = (pyglfs_upcall_t *)data;
+	struct glfs_upcall_inode *in_arg = NULL;
+	pyglfs_upcall_event_t ev;
+
+	if (glfs_upcall_get_reason(up_arg) != GLFS_UPCALL_INODE_INVALIDATE) {
+		glfs_free(up_arg);
+		return;
+	}
+
+	in_arg = glfs_upcall_get_event(up_arg);
+	extract_gfid(glfs_upcall_inode_get_object(in_arg), ev.gfid);
+	extract_gfid(glfs_upcall_inode_get_pobject(in_arg), ev.pgfid);
+	extract_gfid(glfs_upcall_inode_get_oldpobject(in_arg), ev.oldpgfid);
+	ev.flags = glfs_upcall_inode_get_flags(in_arg);
+
+	/* application is responsible for freeing upcall */
+	glfs_free(up_arg);
+
+	if (uuid_is_null(ev.gfid)) {
+		return;
+	}
+
+	pthread_mutex_lock(&up->lock);
+	up->events++;
+	if (up->cnt == UPCALL_QUEUE_MAX) {
+		if (!up->overflow) {
+			up->overflows++;
+		}
+		up->overflow = true;
+	} else {
+		up->queue[(up->head + up->cnt) % UPCALL_QUEUE_MAX] = ev;
+		up->cnt++;
+	}
+	pthread_cond_signal(&up->cond);
+	pthread_mutex_unlock(&up->lock);
+}
+
+static void *upcall_drain_thread(void *data)
+{
+	pyglfs_upcall_t *up = (pyglfs_upcall_t *)data;
+	pyglfs_upcall_event_t batch[UPCALL_BATCH_MAX];
+
+	for (;;) {
+		upcall_sub_t *sub = NULL;
+		size_t cnt = 0;
+
+		pthread_mutex_lock(&up->lock);
+		while (!up->stop && (up->cnt == 0) && !up->overflow) {
+			pthread_cond_wait(&up->cond, &up->lock);
+		}
+
+		if (up->stop) {
+			pthread_mutex_unlock(&up->lock);
+			break;
+		}
+
+		if (up->overflow) {
+			/* queued events are covered by overflow */
+			memset(&batch[0], 0, sizeof(batch[0]));
+			batch[0].flags = PYGLFS_UPCALL_OVERFLOW;
+			up->head = up->cnt = 0;
+			up->overflow = false;
+			cnt = 1;
+		} else {
+			while ((cnt < UPCALL_BATCH_MAX) && up->cnt) {
+				batch[cnt++] = up->queue[up->head];
+				up->head = (up->head + 1) % UPCALL_QUEUE_MAX;
+				up->cnt--;
+			}
+		}
+		pthread_mutex_unlock(&up->lock);
+
+		pthread_mutex_lock(&up->sub_lock);
+		for (sub = up->subs; sub != NULL; sub = sub->next) {
+			sub->fn(batch, cnt, sub->private);
+		}
+		pthread_mutex_unlock(&up->sub_lock);
+	}
+
+	return NULL;
+}
+
+pyglfs_upcall_t *pyglfs_upcall_new(glfs_t *fs)
+{
+	pyglfs_upcall_t *up = NULL;
+	int err;
+
+	up = calloc(1, sizeof(pyglfs_upcall_t));
+	if (up == NULL) {
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	up->fs = fs;
+	pthread_mutex_init(&up->lock, NULL);
+	pthread_mutex_init(&up->sub_lock, NULL);
+	pthread_cond_init(&up->cond, NULL);
+
+	err = pthread_create(&up->thread, NULL, upcall_drain_thread, up);
+	if (err) {
+		errno = err;
+		pyglfs_upcall_free(up);
+		set_exc_from_errno("pthread_create()");
+		return NULL;
+	}
+	up->thread_started = true;
+
+	/*
+	 * Local operation. The GIL is kept so that Volumes sharing a
+	 * glfs_t can't register concurrently.
+	 */
+	err = glfs_upcall_register(fs, GLFS_EVENT_INODE_INVALIDATE,
+				   upcall_cbk, up);
+
+	/* returns registered events on success */
+	if ((err == -1) || !(err & GLFS_EVENT_INODE_INVALIDATE)) {
+		set_glfs_exc("glfs_upcall_register()");
+		up->fs = NULL;
+		pyglfs_upcall_free(up);
+		return NULL;
+	}
+
+	return up;
+}
+
+/*
+ * Get upcall dispatcher for the volume, registering for upcalls
+ * on first use. Requires the GIL.
+ */
+pyglfs_upcall_t *pyglfs_get_upcall(py_glfs_t *py_fs)
+{
+	if (py_fs->upcall != NULL) {
+		return py_fs->upcall;
+	}
+
+	if (py_fs->shared == NULL) {
+		py_fs->upcall = pyglfs_upcall_new(py_fs->fs);
+		return py_fs->upcall;
+	}
+
+	/* only one upcall callback may be registered per glfs_t */
+	if (py_fs->shared->upcall == NULL) {
+		py_fs->shared->upcall = pyglfs_upcall_new(py_fs->fs);
+	}
+	py_fs->upcall = py_fs->shared->upcall;
+	return py_fs->upcall;
+}
+
+/*
+ * Must be called before glfs_fini() for the associated glfs_t.
+ * Does not require the GIL.
+ */
+void pyglfs_upcall_free(pyglfs_upcall_t *up)
+{
+	upcall_sub_t *sub = NULL;
+
+	if (up == NULL) {
+		return;
+	}
+
+	if (up->fs != NULL) {
+		glfs_upcall_unregister(up->fs, GLFS_EVENT_INODE_INVALIDATE);
+	}
+
+	if (up->thread_started) {
+		pthread_mutex_lock(&up->lock);
+		up->stop = true;
+		pthread_cond_signal(&up->cond);
+		pthread_mutex_unlock(&up->lock);
+		pthread_join(up->thread, NULL);
+	}
+
+	while (up->subs != NULL) {
+		sub = up->subs;
+		up->subs = sub->next;
+		free(sub);
+	}
+
+	pthread_cond_destroy(&up->cond);
+	pthread_mutex_destroy(&up->sub_lock);
+	pthread_mutex_destroy(&up->lock);
+	free(up);
+}
+
+bool pyglfs_upcall_subscribe(pyglfs_upcall_t *up,
+			     pyglfs_upcall_fn_t fn,
+			     void *private)
+{
+	upcall_sub_t *sub = NULL;
+
+	sub = calloc(1, sizeof(upcall_sub_t));
+	if (sub == NULL) {
+		return false;
+	}
+
+	sub->fn = fn;
+	sub->private = private;
+
+	pthread_mutex_lock(&up->sub_lock);
+	sub->next = up->subs;
+	up->subs = sub;
+	pthread_mutex_unlock(&up->sub_lock);
+
+	return true;
+}
+
+/*
+ * Once this returns, fn is not running and will not be called again
+ * with the given private data.
+ */
+void pyglfs_upcall_unsubscribe(pyglfs_upcall_t *up,
+			       pyglfs_upcall_fn_t fn,
+			       void *private)
+{
+	upcall_sub_t **pprev = NULL, *sub = NULL;
+
+	pthread_mutex_lock(&up->sub_lock);
+	for (pprev = &up->subs; *pprev != NULL; pprev = &(*pprev)->next) {
+		sub = *pprev;
+		if ((sub->fn == fn) && (sub->private == private)) {
+			*pprev = sub->next;
+			free(sub);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&up->sub_lock);
+}
+
+PyObject *pyglfs_upcall_stats_to_dict(pyglfs_upcall_t *up)
+{
+	uint64_t events, overflows;
+
+	if (up == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	pthread_mutex_lock(&up->lock);
+	events = up->events;
+	overflows = up->overflows;
+	pthread_mutex_unlock(&up->lock);
+
+	return Py_BuildValue(
+		"{s:K,s:K}",
+		"events", (unsigned long long)events,
+		"overflows", (unsigned long long)overflows
+	);
+}
@@ -18,6 +18,9 @@
  */
 
 #include <Python.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include "includes.h"
 #include "pyglfs.h"
 
@@ -75,6 +78,44 @@ static PyObject *py_glfs_get_xlators(PyObject *obj, void *closure)
 	return out;
 }
 
+static PyObject *py_glfs_get_cache_stats(PyObject *obj, void *closure)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+
+	return Py_BuildValue(
+		"{s:N,s:N,s:N,s:N,s:N,s:N}",
+		"attr", pyglfs_cache_stats_to_dict(self->attr_cache),
+		"dentry", pyglfs_cache_stats_to_dict(self->dentry_cache),
+		"block", pyglfs_cache_stats_to_dict(self->block_cache),
+		"fd_pool", pyglfs_cache_stats_to_dict(self->fd_pool),
+		"disk", pyglfs_dcache_stats_to_dict(self->disk_cache),
+		"upcall", pyglfs_upcall_stats_to_dict(self->upcall)
+	);
+}
+
+static PyObject *py_glfs_get_profile(PyObject *obj, void *closure)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+
+	if (self->profile == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	return Py_BuildValue("s", pyglfs_profile_name(self->profile));
+}
+
+static PyObject *py_glfs_get_shards(PyObject *obj, void *closure)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	Py_ssize_t n = 1;
+
+	if (self->shards != NULL) {
+		n += PyTuple_GET_SIZE(self->shards);
+	}
+
+	return PyLong_FromSsize_t(n);
+}
+
 static PyObject *py_glfs_get_volfile_servers(PyObject *obj, void *closure)
 {
 	py_glfs_t *self = (py_glfs_t *)obj;
@@ -91,7 +132,7 @@ static PyObject *py_glfs_get_volfile_servers(PyObject *obj, void *closure)
 		PyObject *entry = NULL;
 
 		entry = Py_BuildValue(
-			"s:s,s:s,s:i",
+			"{s:s,s:s,s:i}",
 			"host", srv->host,
 			"proto", srv->proto,
 			"port", srv->port
@@ -383,21 +424,128 @@ static bool set_xlators(PyObject *xlators, glfs_t *fs)
 	return true;
 }
 
-static bool py_glfs_init_ctx(py_glfs_t *self)
+/*
+ * Registry of glfs_t contexts shared by Volumes with identical
+ * parameters. Only accessed with the GIL held.
+ */
+static pyglfs_shared_fs_t *shared_fs_list;
+
+/*
+ * Build the registry key of a Volume: (name, servers, xlators, profile,
+ * log_file, log_level), with servers a tuple of (proto, host, port).
+ */
+static PyObject *shared_fs_key(py_glfs_t *self)
+{
+	PyObject *servers = NULL, *xlators = NULL, *key = NULL;
+	size_t i;
+
+	servers = PyTuple_New(self->srv_cnt);
+	if (servers == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < self->srv_cnt; i++) {
+		glfs_volfile_server_t *srv = &self->volfile_servers[i];
+		PyObject *entry = Py_BuildValue("(ssi)", srv->proto,
+						srv->host, srv->port);
+		if (entry == NULL) {
+			Py_DECREF(servers);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(servers, i, entry);
+	}
+
+	if (self->xlators != NULL) {
+		xlators = PySequence_Tuple(self->xlators);
+		if (xlators == NULL) {
+			Py_DECREF(servers);
+			return NULL;
+		}
+	} else {
+		Py_INCREF(Py_None);
+		xlators = Py_None;
+	}
+
+	key = Py_BuildValue("(sNNzsi)", self->name, servers, xlators,
+			    self->profile ?
+			    pyglfs_profile_name(self->profile) : NULL,
+			    self->log_file, self->log_level);
+	return key;
+}
+
+static pyglfs_shared_fs_t *shared_fs_lookup(PyObject *key)
+{
+	pyglfs_shared_fs_t *ent;
+
+	for (ent = shared_fs_list; ent != NULL; ent = ent->next) {
+		int cmp = PyObject_RichCompareBool(ent->key, key, Py_EQ);
+		if (cmp == -1) {
+			return NULL;
+		}
+		if (cmp) {
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Drop a Volume's reference to its shared context. Returns true if
+ * this was the last reference, in which case the caller finalizes
+ * the glfs_t and upcall dispatcher returned through fsp and upp.
+ */
+static bool shared_fs_put(pyglfs_shared_fs_t *shared,
+			  glfs_t **fsp,
+			  pyglfs_upcall_t **upp)
+{
+	pyglfs_shared_fs_t **pp;
+
+	if (--shared->refcnt > 0) {
+		return false;
+	}
+
+	for (pp = &shared_fs_list; *pp != NULL; pp = &(*pp)->next) {
+		if (*pp == shared) {
+			*pp = shared->next;
+			break;
+		}
+	}
+
+	*fsp = shared->fs;
+	*upp = shared->upcall;
+	Py_DECREF(shared->key);
+	free(shared);
+	return true;
+}
+
+/*
+ * Create a glfs_t that reads the volfile from the local file `volfile`
+ * if given, otherwise fetches it from the volfile servers. The context
+ * is mounted by connect_mount().
+ */
+static glfs_t *new_fs(py_glfs_t *self, const char *volfile)
 {
 	glfs_t *fs = NULL;
 	size_t i;
-	ssize_t sz;
 	int err;
-	char buf[16];
 
 	fs = glfs_new(self->name);
 	if (fs == NULL) {
 		set_glfs_exc("glfs_new()");
-		return false;
-        }
+		return NULL;
+	}
 
-	for (i = 0; i < self->srv_cnt; i++) {
+	if (volfile != NULL) {
+		err = glfs_set_volfile(fs, volfile);
+		if (err) {
+			set_glfs_exc("glfs_set_volfile()");
+			glfs_fini(fs);
+			return NULL;
+		}
+	}
+
+	for (i = 0; (volfile == NULL) && (i < self->srv_cnt); i++) {
 		glfs_volfile_server_t *srv = &self->volfile_servers[i];
 
 		err = glfs_set_volfile_server(
@@ -411,15 +559,20 @@ static bool py_glfs_init_ctx(py_glfs_t *self)
 				i, srv->proto, srv->host, srv->port
 			);
 			glfs_fini(fs);
-			return false;
+			return NULL;
 		}
-        }
+	}
+
+	/* explicit xlator options take precedence over the profile */
+	if ((self->profile != NULL) &&
+	    !pyglfs_profile_apply(self->profile, fs)) {
+		glfs_fini(fs);
+		return NULL;
+	}
 
 	if (!set_xlators(self->xlators, fs)) {
-		free(self->volfile_servers);
-		self->volfile_servers = NULL;
 		glfs_fini(fs);
-		return false;
+		return NULL;
 	}
 
 	if (self->log_file[0] != '\0') {
@@ -427,24 +580,229 @@ static bool py_glfs_init_ctx(py_glfs_t *self)
 		if (err) {
 			set_glfs_exc("glfs_set_logging()");
 			glfs_fini(fs);
-			return false;
+			return NULL;
+		}
+	}
+
+	return fs;
+}
+
+/*
+ * Replace the local volfile copy with the volfile of a mounted glfs_t.
+ * Best effort, called without the GIL.
+ */
+static void save_volfile(glfs_t *fs, const char *path)
+{
+	char tmp[PATH_MAX];
+	char *buf = NULL;
+	size_t len = 65536;
+	ssize_t sz;
+	int fd, n;
+
+	for (;;) {
+		char *nbuf = realloc(buf, len);
+		if (nbuf == NULL) {
+			free(buf);
+			return;
+		}
+		buf = nbuf;
+
+		/* negative result is the number of bytes missing */
+		sz = glfs_get_volfile(fs, buf, len);
+		if (sz >= 0) {
+			break;
+		}
+		len += -sz;
+	}
+
+	n = snprintf(tmp, sizeof(tmp), "%s.tmp-XXXXXX", path);
+	if ((sz == 0) || (n < 0) || ((size_t)n >= sizeof(tmp))) {
+		free(buf);
+		return;
+	}
+
+	fd = mkostemp(tmp, O_CLOEXEC);
+	if (fd == -1) {
+		free(buf);
+		return;
+	}
+
+	if ((write(fd, buf, sz) != sz) || (fsync(fd) == -1) ||
+	    (rename(tmp, path) == -1)) {
+		unlink(tmp);
+	}
+
+	close(fd);
+	free(buf);
+}
+
+/*
+ * Connection of a Volume to its glfs_t. The blocking glfs_init() is
+ * run by connect_mount() without the GIL, either inline or on a
+ * native thread started by connect_async(). The remaining steps need
+ * the GIL and are completed by the first python thread that uses the
+ * Volume afterwards.
+ */
+struct pyglfs_connect {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool done;		/* protected by lock */
+	bool from_cache;	/* fs configured from volfile_cache */
+	glfs_t *fs;		/* mounted context, NULL on failure */
+	int err;		/* errno of failed glfs_init() */
+	size_t waiters;		/* python threads in connect_wait() */
+	char volfile_cache[PATH_MAX];
+	PyObject *key;		/* registry key if context is shared */
+};
+
+static void connect_free(pyglfs_connect_t *c)
+{
+	if (c->fs != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		glfs_fini(c->fs);
+		Py_END_ALLOW_THREADS
+	}
+
+	Py_XDECREF(c->key);
+	pthread_mutex_destroy(&c->lock);
+	pthread_cond_destroy(&c->cond);
+	free(c);
+}
+
+/* Called without the GIL */
+static void connect_mount(pyglfs_connect_t *c)
+{
+	if (glfs_init(c->fs) == 0) {
+		if (!c->from_cache && (c->volfile_cache[0] != '\0')) {
+			save_volfile(c->fs, c->volfile_cache);
+		}
+		return;
+	}
+
+	c->err = errno;
+	glfs_fini(c->fs);
+	c->fs = NULL;
+}
+
+static void *connect_thread(void *data)
+{
+	pyglfs_connect_t *c = (pyglfs_connect_t *)data;
+
+	connect_mount(c);
+
+	pthread_mutex_lock(&c->lock);
+	c->done = true;
+	pthread_cond_broadcast(&c->cond);
+	pthread_mutex_unlock(&c->lock);
+
+	return NULL;
+}
+
+/*
+ * Wait up to `timeout` seconds, or indefinitely if negative, for the
+ * mount to finish. Returns false on timeout.
+ */
+static bool connect_wait(pyglfs_connect_t *c, double timeout)
+{
+	struct timespec ts;
+	bool done;
+	int err = 0;
+
+	if (timeout >= 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += (time_t)timeout;
+		ts.tv_nsec += (long)((timeout - (time_t)timeout) * 1000000000.0);
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
 		}
 	}
 
+	c->waiters++;
 	Py_BEGIN_ALLOW_THREADS
-	err = glfs_init(fs);
+	pthread_mutex_lock(&c->lock);
+	while (!c->done && (err != ETIMEDOUT)) {
+		if (timeout < 0) {
+			pthread_cond_wait(&c->cond, &c->lock);
+		} else {
+			err = pthread_cond_timedwait(&c->cond, &c->lock, &ts);
+		}
+	}
+	done = c->done;
+	pthread_mutex_unlock(&c->lock);
 	Py_END_ALLOW_THREADS
+	c->waiters--;
+
+	return done;
+}
+
+/*
+ * Attach Volume to a live shared context with the same parameters.
+ * Returns 1 if attached, 0 if there is none and -1 on error. The
+ * registry key is returned through keyp for registering a new context.
+ */
+static int attach_shared(py_glfs_t *self, PyObject **keyp)
+{
+	pyglfs_shared_fs_t *ent = NULL;
+	PyObject *key = NULL;
+
+	key = shared_fs_key(self);
+	if (key == NULL) {
+		return -1;
+	}
+
+	ent = shared_fs_lookup(key);
+	if (ent == NULL) {
+		if (PyErr_Occurred()) {
+			Py_DECREF(key);
+			return -1;
+		}
+		*keyp = key;
+		return 0;
+	}
+
+	Py_DECREF(key);
+	ent->refcnt++;
+	strlcpy(self->vol_id, ent->vol_id, sizeof(self->vol_id));
+	self->fs = ent->fs;
+	self->shared = ent;
+	return 1;
+}
+
+/*
+ * Take mounted context from connection, and add it to the registry of
+ * shared contexts if the Volume is shared.
+ */
+static bool connect_finish(py_glfs_t *self, pyglfs_connect_t *c)
+{
+	pyglfs_shared_fs_t *ent = NULL;
+	glfs_t *fs = NULL;
+	size_t i;
+	ssize_t sz;
+	char buf[16];
+
+	if ((c->fs == NULL) && c->from_cache) {
+		/* missing, stale or rejected copy */
+		c->from_cache = false;
+		c->fs = new_fs(self, NULL);
+		if (c->fs == NULL) {
+			return false;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		connect_mount(c);
+		Py_END_ALLOW_THREADS
+	}
 
-	if (err) {
+	if (c->fs == NULL) {
+		errno = c->err;
 		set_glfs_exc("glfs_init()");
-		glfs_fini(fs);
 		return false;
 	}
 
-	sz = glfs_get_volumeid(fs, buf, sizeof(buf));
+	sz = glfs_get_volumeid(c->fs, buf, sizeof(buf));
 	if (sz == -1) {
 		set_glfs_exc("glfs_get_volumeid()");
-		glfs_fini(fs);
 		return false;
 	}
 	if (sz == 16) {
@@ -455,102 +813,647 @@ static bool py_glfs_init_ctx(py_glfs_t *self)
 		uuid_unparse(ui, self->vol_id);
 	}
 
+	fs = c->fs;
+	c->fs = NULL;
 	self->fs = fs;
 
-	return true;
-}
-
-static int py_glfs_init(PyObject *obj,
-		        PyObject *args,
-		        PyObject *kwargs)
-{
-	py_glfs_t *self = (py_glfs_t *)obj;
-	const char *volname = NULL;
-	PyObject *volfile_list = NULL;
-	PyObject *xlators = NULL;
-	const char *log_file = NULL;
-	int log_level = -1;
-
-	const char *kwnames [] = {
-		"volume_name",
-		"volfile_servers",
-		"xlators",
-		"log_file",
-		"log_level",
-		NULL
-	};
-
-	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|Osi",
-					 discard_const_p(char *, kwnames),
-					 &volname, &volfile_list, &xlators,
-					 &log_file, &log_level)) {
-		return -1;
+	/*
+	 * A Volume with identical parameters may have been registered
+	 * while glfs_init() ran without the GIL. Keep our own context
+	 * unshared in that case.
+	 */
+	if ((c->key == NULL) || (shared_fs_lookup(c->key) != NULL)) {
+		PyErr_Clear();
+		return true;
 	}
+	PyErr_Clear();
 
-	if (volname == NULL) {
-		PyErr_SetString(
-			PyExc_ValueError,
-			"volume must be specified"
-		);
-		return -1;
+	ent = calloc(1, sizeof(pyglfs_shared_fs_t));
+	if (ent == NULL) {
+		/* context is still usable unshared */
+		return true;
 	}
 
-	if (strlen(volname) > sizeof(self->name)) {
-		PyErr_Format(
-			PyExc_ValueError,
-			"%s: volume name is too long.",
-			volname
-		);
-		return -1;
-	}
-	strlcpy(self->name, volname, sizeof(self->name));
+	ent->key = c->key;
+	c->key = NULL;
+	ent->fs = fs;
+	ent->refcnt = 1;
+	strlcpy(ent->vol_id, self->vol_id, sizeof(ent->vol_id));
+	ent->next = shared_fs_list;
+	shared_fs_list = ent;
+	self->shared = ent;
 
-	if (log_file && (strlen(log_file) > sizeof(self->log_file))) {
-		PyErr_Format(
-			PyExc_ValueError,
-			"%s: logfile path too long.",
-			log_file
-		);
-		return -1;
-	}
+	return true;
+}
 
-	if (log_file != NULL) {
-		strlcpy(self->log_file, log_file, sizeof(self->log_file));
+/* set up parts of the Volume that need the context */
+static bool volume_setup(py_glfs_t *self)
+{
+	if ((self->attr_cache == NULL) && (self->dentry_cache == NULL) &&
+	    (self->block_cache == NULL) && (self->fd_pool == NULL)) {
+		return true;
 	}
 
-	self->log_level = log_level;
-	self->xlators = xlators;
-
-	if (!py_glfs_init_fill_volfile(self, volfile_list)) {
-		return -1;
+	/* evict entries changed by other clients */
+	if (pyglfs_get_upcall(self) == NULL) {
+		return false;
 	}
 
-	if (!py_glfs_init_ctx(self)) {
-		return -1;
+	if (!pyglfs_upcall_subscribe(self->upcall,
+				     pyglfs_cache_upcall_cb, self)) {
+		PyErr_NoMemory();
+		return false;
 	}
 
-	return 0;
+	return true;
 }
 
-static void py_glfs_dealloc(py_glfs_t *self)
+/* complete connect of Volume once its mount has finished */
+static bool connect_complete(py_glfs_t *self)
 {
-	if (self->volfile_servers != NULL) {
-		free(self->volfile_servers);
-		self->volfile_servers = NULL;
-	}
+	pyglfs_connect_t *c = self->connect;
+	bool ok;
 
-	if (self->fs != NULL) {
-		Py_BEGIN_ALLOW_THREADS
-		glfs_fini(self->fs);
-		Py_END_ALLOW_THREADS
-		self->fs = NULL;
+	self->connect = NULL;
+	ok = connect_finish(self, c) && volume_setup(self);
+	if (c->waiters == 0) {
+		connect_free(c);
 	}
-	Py_TYPE(self)->tp_free((PyObject *)self);
+	/* otherwise freed by last waiter */
+
+	return ok;
 }
 
-PyDoc_STRVAR(py_glfs_get_root_handle__doc__,
-"get_root_handle()\n"
-"--\n\n"
+/*
+ * Start connecting Volume to its glfs_t. If `async` is set glfs_init()
+ * runs on a native thread, otherwise the connect is completed before
+ * returning.
+ */
+static bool connect_start(py_glfs_t *self, bool async)
+{
+	pyglfs_connect_t *c = NULL;
+	PyObject *key = NULL;
+	pthread_attr_t attr;
+	pthread_t thread;
+	int err;
+
+	if (self->closed) {
+		PyErr_SetString(PyExc_ValueError, "Volume is closed.");
+		return false;
+	}
+
+	if (self->share_ctx) {
+		err = attach_shared(self, &key);
+		if (err == -1) {
+			return false;
+		}
+		if (err == 1) {
+			return volume_setup(self);
+		}
+	}
+
+	c = calloc(1, sizeof(pyglfs_connect_t));
+	if (c == NULL) {
+		Py_XDECREF(key);
+		PyErr_NoMemory();
+		return false;
+	}
+
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->cond, NULL);
+	c->key = key;
+	strlcpy(c->volfile_cache, self->volfile_cache,
+		sizeof(c->volfile_cache));
+
+	if ((c->volfile_cache[0] != '\0') &&
+	    (access(c->volfile_cache, R_OK) == 0)) {
+		c->fs = new_fs(self, c->volfile_cache);
+		if (c->fs == NULL) {
+			PyErr_Clear();
+		} else {
+			c->from_cache = true;
+		}
+	}
+
+	if (c->fs == NULL) {
+		c->fs = new_fs(self, NULL);
+		if (c->fs == NULL) {
+			connect_free(c);
+			return false;
+		}
+	}
+
+	self->connect = c;
+
+	if (async) {
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		err = pthread_create(&thread, &attr, connect_thread, c);
+		pthread_attr_destroy(&attr);
+		if (err == 0) {
+			return true;
+		}
+		/* mount inline instead */
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	connect_mount(c);
+	Py_END_ALLOW_THREADS
+	c->done = true;
+
+	return connect_complete(self);
+}
+
+/*
+ * Make sure Volume is connected, waiting for a background connect
+ * started by connect_async() if necessary.
+ */
+static bool volume_connect(py_glfs_t *self)
+{
+	pyglfs_connect_t *c = NULL;
+
+	if (self->closed) {
+		PyErr_SetString(PyExc_ValueError, "Volume is closed.");
+		return false;
+	}
+
+	while (self->fs == NULL) {
+		c = self->connect;
+		if (c == NULL) {
+			return connect_start(self, false);
+		}
+
+		connect_wait(c, -1);
+		if (self->connect == c) {
+			return connect_complete(self);
+		}
+
+		/* completed by another thread, retry if it failed */
+		if (c->waiters == 0) {
+			connect_free(c);
+		}
+	}
+
+	return true;
+}
+
+/* connect Volume and all of its shards */
+static bool volume_connect_all(py_glfs_t *self)
+{
+	Py_ssize_t i;
+
+	if (!volume_connect(self)) {
+		return false;
+	}
+
+	for (i = 0; (self->shards != NULL) &&
+	     (i < PyTuple_GET_SIZE(self->shards)); i++) {
+		py_glfs_t *shard = (py_glfs_t *)PyTuple_GET_ITEM(self->shards, i);
+		if (!volume_connect(shard)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Allocate a client-side cache if ttl is non-zero. Entries are
+ * kept for `ttl` seconds and at most `size` entries are cached.
+ */
+static bool init_cache_param(const char *name,
+			     double ttl,
+			     Py_ssize_t size,
+			     pyglfs_cache_t **cache)
+{
+	if (ttl == 0) {
+		return true;
+	}
+
+	if ((ttl < 0) || (size < 1)) {
+		PyErr_Format(
+			PyExc_ValueError,
+			"%s: ttl must be non-negative and size must be "
+			"at least one entry.", name
+		);
+		return false;
+	}
+
+	pyglfs_cache_free(*cache);
+	*cache = pyglfs_cache_new(size, (uint64_t)(ttl * 1000000000.0));
+	if (*cache == NULL) {
+		PyErr_NoMemory();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Select the glfs_t context for a new handle. Operations on a known gfid
+ * always go to the same shard, so that its caches stay coherent. Others are spread round-robin. Handles and FDs keep a
+ * reference to the Volume of their shard, which pins them to it.
+ */
+static py_glfs_t *volume_shard(py_glfs_t *self, const unsigned char *gfid)
+{
+	size_t n, idx;
+
+	if (self->shards == NULL) {
+		return self;
+	}
+
+	n = PyTuple_GET_SIZE(self->shards) + 1;
+	if (gfid != NULL) {
+		idx = pyglfs_hash(gfid, sizeof(uuid_t)) % n;
+	} else {
+		idx = self->next_shard++ % n;
+	}
+
+	if (idx == 0) {
+		return self;
+	}
+
+	return (py_glfs_t *)PyTuple_GET_ITEM(self->shards, idx - 1);
+}
+
+/*
+ * Create the additional shards with same parameters as this Volume.
+ */
+static bool init_shards(py_glfs_t *self, PyObject *args, PyObject *kwargs,
+			Py_ssize_t nshards)
+{
+	PyObject *kw = NULL, *one = NULL;
+	Py_ssize_t i;
+
+	kw = (kwargs != NULL) ? PyDict_Copy(kwargs) : PyDict_New();
+	if (kw == NULL) {
+		return false;
+	}
+
+	one = PyLong_FromLong(1);
+	if ((one == NULL) || (PyDict_SetItemString(kw, "shards", one) == -1) ||
+	    (PyDict_SetItemString(kw, "shared", Py_False) == -1)) {
+		Py_XDECREF(one);
+		Py_DECREF(kw);
+		return false;
+	}
+	Py_DECREF(one);
+
+	self->shards = PyTuple_New(nshards - 1);
+	if (self->shards == NULL) {
+		Py_DECREF(kw);
+		return false;
+	}
+
+	for (i = 0; i < nshards - 1; i++) {
+		PyObject *shard = PyObject_Call((PyObject *)Py_TYPE(self),
+						args, kw);
+		if (shard == NULL) {
+			Py_CLEAR(self->shards);
+			Py_DECREF(kw);
+			return false;
+		}
+		PyTuple_SET_ITEM(self->shards, i, shard);
+	}
+
+	Py_DECREF(kw);
+	return true;
+}
+
+static int py_glfs_init(PyObject *obj,
+		        PyObject *args,
+		        PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	const char *volname = NULL;
+	PyObject *volfile_list = NULL;
+	PyObject *xlators = NULL;
+	const char *log_file = NULL;
+	int log_level = -1;
+	double attr_cache_ttl = 0;
+	Py_ssize_t attr_cache_size = PYGLFS_DEFAULT_CACHE_ENTRIES;
+	double dentry_cache_ttl = 0;
+	Py_ssize_t dentry_cache_size = PYGLFS_DEFAULT_CACHE_ENTRIES;
+	double block_cache_ttl = 0;
+	Py_ssize_t block_cache_size = PYGLFS_DEFAULT_BLOCK_CACHE_BYTES;
+	Py_ssize_t block_size = PYGLFS_DEFAULT_BLOCK_SIZE;
+	const char *disk_cache_dir = NULL;
+	Py_ssize_t disk_cache_size = PYGLFS_DEFAULT_DISK_CACHE_BYTES;
+	bool intern_handles = false;
+	Py_ssize_t nshards = 1;
+	bool shared = false;
+	const char *volfile_cache = NULL;
+	bool lazy = false;
+	bool background_fini = true;
+	const char *profile = NULL;
+	double fd_pool_ttl = 0;
+	Py_ssize_t fd_pool_size = PYGLFS_DEFAULT_FD_POOL_ENTRIES;
+
+	const char *kwnames [] = {
+		"volume_name",
+		"volfile_servers",
+		"xlators",
+		"log_file",
+		"log_level",
+		"attr_cache_ttl",
+		"attr_cache_size",
+		"dentry_cache_ttl",
+		"dentry_cache_size",
+		"block_cache_ttl",
+		"block_cache_size",
+		"block_cache_block_size",
+		"disk_cache_dir",
+		"disk_cache_size",
+		"intern_handles",
+		"shards",
+		"shared",
+		"volfile_cache",
+		"lazy",
+		"background_fini",
+		"profile",
+		"fd_pool_ttl",
+		"fd_pool_size",
+		NULL
+	};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|Osi$dndndnnznbnbzbbzdn",
+					 discard_const_p(char *, kwnames),
+					 &volname, &volfile_list, &xlators,
+					 &log_file, &log_level,
+					 &attr_cache_ttl, &attr_cache_size,
+					 &dentry_cache_ttl, &dentry_cache_size,
+					 &block_cache_ttl, &block_cache_size,
+					 &block_size,
+					 &disk_cache_dir, &disk_cache_size,
+					 &intern_handles, &nshards, &shared,
+					 &volfile_cache, &lazy,
+					 &background_fini, &profile,
+					 &fd_pool_ttl, &fd_pool_size)) {
+		return -1;
+	}
+
+	if (!init_cache_param("attr_cache", attr_cache_ttl,
+			      attr_cache_size, &self->attr_cache)) {
+		return -1;
+	}
+
+	if (!init_cache_param("dentry_cache", dentry_cache_ttl,
+			      dentry_cache_size, &self->dentry_cache)) {
+		return -1;
+	}
+
+	if ((block_cache_ttl != 0) &&
+	    ((block_size < 4096) || (block_cache_size < block_size))) {
+		PyErr_SetString(
+			PyExc_ValueError,
+			"block_cache: block size must be at least 4096 bytes "
+			"and cache size must hold at least one block."
+		);
+		return -1;
+	}
+
+	if (!init_cache_param("block_cache", block_cache_ttl,
+			      block_cache_size / block_size,
+			      &self->block_cache)) {
+		return -1;
+	}
+
+	if (self->block_cache != NULL) {
+		pyglfs_cache_set_max_bytes(self->block_cache, block_cache_size);
+		self->block_size = block_size;
+	}
+
+	if (!init_cache_param("fd_pool", fd_pool_ttl,
+			      fd_pool_size, &self->fd_pool)) {
+		return -1;
+	}
+
+	if (self->fd_pool != NULL) {
+		pyglfs_fdpool_setup(self->fd_pool);
+	}
+
+	if ((nshards < 1) || (nshards > PYGLFS_MAX_SHARDS)) {
+		PyErr_Format(PyExc_ValueError,
+			     "shards: must be between 1 and %d.",
+			     PYGLFS_MAX_SHARDS);
+		return -1;
+	}
+
+	if (disk_cache_dir != NULL) {
+		if (nshards > 1) {
+			/* shards would evict each other's files */
+			PyErr_SetString(PyExc_ValueError,
+					"disk_cache_dir is not supported with shards.");
+			return -1;
+		}
+
+		if (disk_cache_size < 1) {
+			PyErr_SetString(PyExc_ValueError,
+					"disk_cache: size must be positive.");
+			return -1;
+		}
+
+		self->disk_cache = pyglfs_dcache_new(disk_cache_dir,
+						     disk_cache_size);
+		if (self->disk_cache == NULL) {
+			return -1;
+		}
+	}
+
+	if (intern_handles) {
+		if (nshards > 1) {
+			/* a gfid may get a handle in each shard */
+			PyErr_SetString(PyExc_ValueError,
+					"intern_handles is not supported with shards.");
+			return -1;
+		}
+
+		self->handles = pyglfs_handle_table_new();
+		if (self->handles == NULL) {
+			PyErr_NoMemory();
+			return -1;
+		}
+	}
+
+	if (volname == NULL) {
+		PyErr_SetString(
+			PyExc_ValueError,
+			"volume must be specified"
+		);
+		return -1;
+	}
+
+	if (strlen(volname) > sizeof(self->name)) {
+		PyErr_Format(
+			PyExc_ValueError,
+			"%s: volume name is too long.",
+			volname
+		);
+		return -1;
+	}
+	strlcpy(self->name, volname, sizeof(self->name));
+
+	if (log_file && (strlen(log_file) > sizeof(self->log_file))) {
+		PyErr_Format(
+			PyExc_ValueError,
+			"%s: logfile path too long.",
+			log_file
+		);
+		return -1;
+	}
+
+	if (log_file != NULL) {
+		strlcpy(self->log_file, log_file, sizeof(self->log_file));
+	}
+
+	if (volfile_cache != NULL) {
+		if (strlen(volfile_cache) >= sizeof(self->volfile_cache)) {
+			PyErr_Format(
+				PyExc_ValueError,
+				"%s: volfile cache path too long.",
+				volfile_cache
+			);
+			return -1;
+		}
+		strlcpy(self->volfile_cache, volfile_cache,
+			sizeof(self->volfile_cache));
+	}
+
+	if (profile != NULL) {
+		self->profile = pyglfs_profile_lookup(profile);
+		if (self->profile == NULL) {
+			return -1;
+		}
+	}
+
+	self->log_level = log_level;
+	Py_XINCREF(xlators);
+	Py_XSETREF(self->xlators, xlators);
+
+	if (!py_glfs_init_fill_volfile(self, volfile_list)) {
+		return -1;
+	}
+
+	/* shards exist to get independent contexts */
+	self->share_ctx = shared && (nshards == 1);
+	self->background_fini = background_fini;
+
+	if (!lazy && !connect_start(self, false)) {
+		return -1;
+	}
+
+	/* shards inherit `lazy` */
+	if ((nshards > 1) && !init_shards(self, args, kwargs, nshards)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Release the Volume's glfs_t. The context is finalized on the reaper
+ * thread unless `wait` is set, or kept if other Volumes share it.
+ */
+static void volume_close_ctx(py_glfs_t *self, bool wait)
+{
+	pyglfs_connect_t *c = self->connect;
+	pyglfs_upcall_t *upcall = NULL;
+	glfs_t *fs = NULL;
+
+	if (c != NULL) {
+		self->connect = NULL;
+		/* otherwise freed by last waiter */
+		if (c->waiters == 0) {
+			/* background mount can't be cancelled */
+			connect_wait(c, -1);
+			if ((c->fs != NULL) && !wait &&
+			    pyglfs_reaper_queue(c->fs, NULL)) {
+				c->fs = NULL;
+			}
+			connect_free(c);
+		}
+	}
+
+	/* idle fds must be closed before their context goes away */
+	if (self->fd_pool != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		pyglfs_cache_clear(self->fd_pool);
+		Py_END_ALLOW_THREADS
+	}
+
+	/* dispatcher may outlive this Volume */
+	if (self->upcall != NULL) {
+		Py_BEGIN_ALLOW_THREADS
+		pyglfs_upcall_unsubscribe(self->upcall,
+					  pyglfs_cache_upcall_cb, self);
+		Py_END_ALLOW_THREADS
+	}
+
+	if (self->shared != NULL) {
+		shared_fs_put(self->shared, &fs, &upcall);
+	} else {
+		fs = self->fs;
+		upcall = self->upcall;
+	}
+	self->shared = NULL;
+	self->fs = NULL;
+	self->upcall = NULL;
+
+	if ((fs == NULL) || (!wait && pyglfs_reaper_queue(fs, upcall))) {
+		return;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pyglfs_upcall_free(upcall);
+	glfs_fini(fs);
+	Py_END_ALLOW_THREADS
+}
+
+void pyglfs_volume_hold(py_glfs_t *py_fs)
+{
+	Py_INCREF(py_fs);
+	py_fs->nholds++;
+}
+
+void pyglfs_volume_release(py_glfs_t *py_fs)
+{
+	if ((--py_fs->nholds == 0) && py_fs->closed) {
+		volume_close_ctx(py_fs, !py_fs->background_fini);
+	}
+	Py_DECREF(py_fs);
+}
+
+static void py_glfs_dealloc(py_glfs_t *self)
+{
+	if (!self->closed) {
+		volume_close_ctx(self, !self->background_fini);
+	}
+
+	if (self->volfile_servers != NULL) {
+		free(self->volfile_servers);
+		self->volfile_servers = NULL;
+	}
+
+	pyglfs_cache_free(self->attr_cache);
+	self->attr_cache = NULL;
+	pyglfs_cache_free(self->dentry_cache);
+	self->dentry_cache = NULL;
+	pyglfs_cache_free(self->block_cache);
+	self->block_cache = NULL;
+	pyglfs_cache_free(self->fd_pool);
+	self->fd_pool = NULL;
+	pyglfs_dcache_free(self->disk_cache);
+	self->disk_cache = NULL;
+	pyglfs_handle_table_free(self->handles);
+	self->handles = NULL;
+	Py_CLEAR(self->shards);
+	Py_CLEAR(self->xlators);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyDoc_STRVAR(py_glfs_get_root_handle__doc__,
+"get_root_handle()\n"
+"--\n\n"
 "Opens a GLFS object handle for the root `/` of gluster volume.\n"
 "This handle may be used as basis of opening object handles for other\n"
 "files and directories in the gluster volume.\n\n"
@@ -566,11 +1469,15 @@ static PyObject *py_glfs_get_root(PyObject *obj,
 				  PyObject *args_unused,
 				  PyObject *kwargs_unused)
 {
-	py_glfs_t *self = (py_glfs_t *)obj;
+	py_glfs_t *self = volume_shard((py_glfs_t *)obj, NULL);
 	glfs_object_t *gl_obj = NULL;
 	struct stat st;
 	const char *path = "/";
 
+	if (!volume_connect(self)) {
+		return NULL;
+	}
+
 	Py_BEGIN_ALLOW_THREADS
 	gl_obj = glfs_h_lookupat(
 		self->fs,
@@ -619,6 +1526,10 @@ static PyObject *py_glfs_getcwd(PyObject *obj,
 	char buf[PATH_MAX + 1];
 	char *cwd = NULL;
 
+	if (!volume_connect(self)) {
+		return NULL;
+	}
+
 	Py_BEGIN_ALLOW_THREADS
 	cwd = glfs_getcwd(self->fs, buf, PATH_MAX);
 	Py_END_ALLOW_THREADS
@@ -664,6 +1575,11 @@ static PyObject *py_glfs_open_by_uuid(PyObject *obj,
 		return NULL;
 	}
 
+	self = volume_shard(self, ui);
+	if (!volume_connect(self)) {
+		return NULL;
+	}
+
 	Py_BEGIN_ALLOW_THREADS
 	gl_obj = glfs_h_create_from_handle(
 		self->fs,
@@ -681,7 +1597,458 @@ static PyObject *py_glfs_open_by_uuid(PyObject *obj,
 	return init_glfs_object(self, gl_obj, &st, NULL);
 }
 
+PyDoc_STRVAR(py_glfs_open_many_by_uuid__doc__,
+"open_many_by_uuid(uuids, threads=1)\n"
+"--\n\n"
+"Open new pyglfs.ObjectHandles for a list of UUIDs.\n"
+"Handles are resolved concurrently from up to `threads` native threads\n"
+"without holding the GIL.\n\n"
+"Parameters\n"
+"----------\n"
+"uuids : list\n"
+"    UUIDs of gluster files or directories. Each entry may be either a\n"
+"    UUID string or 16 bytes containing the raw gfid.\n"
+"threads : int, optional, default=1\n"
+"    Number of threads to use for resolving handles.\n\n"
+"Returns\n"
+"-------\n"
+"handles : list\n"
+"    glfs.ObjectHandle for each UUID in same order as `uuids`. Entries\n"
+"    are None if UUID no longer exists (ESTALE or ENOENT).\n"
+);
+
+struct uuid_batch {
+	py_glfs_t **vols;	/* shard for each uuid */
+	uuid_t *uuids;
+	glfs_object_t **objs;
+	struct stat *st;
+	int *err;
+};
+
+static void open_by_uuid_job(size_t idx, void *private)
+{
+	struct uuid_batch *b = (struct uuid_batch *)private;
+
+	b->objs[idx] = glfs_h_create_from_handle(
+		b->vols[idx]->fs,
+		b->uuids[idx],
+		sizeof(uuid_t),
+		&b->st[idx]
+	);
+	if (b->objs[idx] == NULL) {
+		b->err[idx] = errno;
+	}
+}
+
+static bool parse_uuid_entry(PyObject *entry, Py_ssize_t idx, uuid_t ui)
+{
+	if (PyUnicode_Check(entry)) {
+		const char *uuid_str = PyUnicode_AsUTF8(entry);
+		if (uuid_str == NULL) {
+			return false;
+		}
+
+		if (uuid_parse(uuid_str, ui) == -1) {
+			PyErr_Format(
+				PyExc_ValueError,
+				"%s: entry %zd is not a valid UUID.",
+				uuid_str, idx
+			);
+			return false;
+		}
+		return true;
+	}
+
+	if (PyBytes_Check(entry)) {
+		if (PyBytes_GET_SIZE(entry) != sizeof(uuid_t)) {
+			PyErr_Format(
+				PyExc_ValueError,
+				"entry %zd: raw gfid must be %zu bytes.",
+				idx, sizeof(uuid_t)
+			);
+			return false;
+		}
+		memcpy(ui, PyBytes_AS_STRING(entry), sizeof(uuid_t));
+		return true;
+	}
+
+	PyErr_Format(
+		PyExc_TypeError,
+		"entry %zd: UUID must be str or bytes.", idx
+	);
+	return false;
+}
+
+static PyObject *py_glfs_open_many_by_uuid(PyObject *obj,
+					   PyObject *args,
+					   PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	PyObject *uuids = NULL, *seq = NULL, *out = NULL;
+	struct uuid_batch b = { .vols = NULL };
+	Py_ssize_t cnt, i;
+	int threads = 1;
+	const char *kwnames [] = { "uuids", "threads", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i",
+					 discard_const_p(char *, kwnames),
+					 &uuids, &threads)) {
+		return NULL;
+	}
+
+	if (!pyglfs_check_threads(threads)) {
+		return NULL;
+	}
+
+	if (!volume_connect_all(self)) {
+		return NULL;
+	}
+
+	seq = PySequence_Fast(uuids, "uuids must be a list.");
+	if (seq == NULL) {
+		return NULL;
+	}
+	cnt = PySequence_Fast_GET_SIZE(seq);
+
+	b.vols = calloc(cnt, sizeof(py_glfs_t *));
+	b.uuids = calloc(cnt, sizeof(uuid_t));
+	b.objs = calloc(cnt, sizeof(glfs_object_t *));
+	b.st = calloc(cnt, sizeof(struct stat));
+	b.err = calloc(cnt, sizeof(int));
+	if (!b.vols || !b.uuids || !b.objs || !b.st || !b.err) {
+		PyErr_NoMemory();
+		goto out;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (!parse_uuid_entry(PySequence_Fast_GET_ITEM(seq, i), i,
+				      b.uuids[i])) {
+			goto out;
+		}
+		b.vols[i] = volume_shard(self, b.uuids[i]);
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pyglfs_run_jobs(cnt, threads, open_by_uuid_job, &b);
+	Py_END_ALLOW_THREADS
+
+	for (i = 0; i < cnt; i++) {
+		if ((b.objs[i] == NULL) &&
+		    (b.err[i] != ESTALE) && (b.err[i] != ENOENT)) {
+			errno = b.err[i];
+			set_glfs_exc("glfs_h_create_from_handle()");
+			goto out;
+		}
+	}
+
+	out = PyList_New(cnt);
+	if (out == NULL) {
+		goto out;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		PyObject *hdl = NULL;
+
+		if (b.objs[i] == NULL) {
+			Py_INCREF(Py_None);
+			PyList_SET_ITEM(out, i, Py_None);
+			continue;
+		}
+
+		hdl = init_glfs_object(b.vols[i], b.objs[i], &b.st[i], NULL);
+		if (hdl == NULL) {
+			Py_CLEAR(out);
+			goto out;
+		}
+		/* ownership passes to the python handle */
+		b.objs[i] = NULL;
+		PyList_SET_ITEM(out, i, hdl);
+	}
+
+out:
+	if (b.objs != NULL) {
+		for (i = 0; i < cnt; i++) {
+			if (b.objs[i] != NULL) {
+				glfs_h_close(b.objs[i]);
+			}
+		}
+	}
+	free(b.vols);
+	free(b.uuids);
+	free(b.objs);
+	free(b.st);
+	free(b.err);
+	Py_DECREF(seq);
+	return out;
+}
+
+PyDoc_STRVAR(py_glfs_watch__doc__,
+"watch(max_events=4096)\n"
+"--\n\n"
+"Create change notification stream for the volume. Inode\n"
+"invalidation upcalls sent by the servers are delivered as events.\n"
+"This requires `features.cache-invalidation` to be enabled on the\n"
+"volume. Only objects that this client has accessed are reported.\n\n"
+"Parameters\n"
+"----------\n"
+"max_events : int, optional, default=4096\n"
+"    Maximum number of events queued before events are dropped.\n\n"
+"Returns\n"
+"-------\n"
+"pyglfs.Watch\n"
+);
+
+static PyObject *py_glfs_watch(PyObject *obj,
+			       PyObject *args,
+			       PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	Py_ssize_t max_events = 4096;
+	const char *kwnames [] = { "max_events", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n",
+					 discard_const_p(char *, kwnames),
+					 &max_events)) {
+		return NULL;
+	}
+
+	if (max_events < 1) {
+		PyErr_SetString(PyExc_ValueError,
+				"max_events must be at least one event");
+		return NULL;
+	}
+
+	if (!volume_connect(self)) {
+		return NULL;
+	}
+
+	return init_glfs_watch(self, max_events);
+}
+
+PyDoc_STRVAR(py_glfs_connect__doc__,
+"connect(timeout=None)\n"
+"--\n\n"
+"Connect the volume and its shards if not yet done. Waits for a\n"
+"connect started by connect_async() to finish.\n\n"
+"Parameters\n"
+"----------\n"
+"timeout : float, optional, default=None\n"
+"    Seconds to wait for a background connect. None waits until done.\n\n"
+"Returns\n"
+"-------\n"
+"bool\n"
+"    False if timeout expired before the volume was connected.\n"
+);
+
+static PyObject *py_glfs_connect(PyObject *obj,
+				 PyObject *args,
+				 PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	PyObject *pytimeout = Py_None;
+	double timeout = -1;
+	Py_ssize_t i, n;
+	const char *kwnames [] = { "timeout", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O",
+					 discard_const_p(char *, kwnames),
+					 &pytimeout)) {
+		return NULL;
+	}
+
+	if (pytimeout != Py_None) {
+		timeout = PyFloat_AsDouble(pytimeout);
+		if ((timeout == -1) && PyErr_Occurred()) {
+			return NULL;
+		}
+
+		if (timeout < 0) {
+			PyErr_SetString(PyExc_ValueError,
+					"timeout must be non-negative");
+			return NULL;
+		}
+	}
+
+	n = (self->shards != NULL) ? PyTuple_GET_SIZE(self->shards) : 0;
+	for (i = -1; i < n; i++) {
+		py_glfs_t *vol = (i == -1) ? self :
+		    (py_glfs_t *)PyTuple_GET_ITEM(self->shards, i);
+
+		if ((timeout >= 0) && (vol->connect != NULL) &&
+		    !connect_wait(vol->connect, timeout)) {
+			Py_RETURN_FALSE;
+		}
+	}
+
+	if (!volume_connect_all(self)) {
+		return NULL;
+	}
+
+	Py_RETURN_TRUE;
+}
+
+PyDoc_STRVAR(py_glfs_connect_async__doc__,
+"connect_async()\n"
+"--\n\n"
+"Start connecting the volume and its shards on native threads and\n"
+"return immediately. The `ready` attribute becomes True once done.\n"
+"The first use of the volume, or connect(), waits for the connect to\n"
+"finish and raises its error if it failed. Has no effect if the\n"
+"volume is connected or connecting.\n\n"
+"Returns\n"
+"-------\n"
+"None\n"
+);
+
+static PyObject *py_glfs_connect_async(PyObject *obj,
+				       PyObject *args_unused)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	Py_ssize_t i, n;
+
+	n = (self->shards != NULL) ? PyTuple_GET_SIZE(self->shards) : 0;
+	for (i = -1; i < n; i++) {
+		py_glfs_t *vol = (i == -1) ? self :
+		    (py_glfs_t *)PyTuple_GET_ITEM(self->shards, i);
+
+		if ((vol->fs != NULL) || (vol->connect != NULL)) {
+			continue;
+		}
+
+		if (!connect_start(vol, true)) {
+			return NULL;
+		}
+	}
+
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(py_glfs_benchmark_profiles__doc__,
+"benchmark_profiles(path, workload, iterations=3)\n"
+"--\n\n"
+"Measure a workload under each profile and without a profile. For\n"
+"each, a private context is connected with the parameters of this\n"
+"volume and the workload is run `iterations` times against `path`.\n"
+"Connection time is not included.\n\n"
+"Parameters\n"
+"----------\n"
+"path : str\n"
+"    Path from the volume root. A file for `streaming-read`, otherwise\n"
+"    a directory.\n"
+"workload : str\n"
+"    `metadata-heavy` - lookup and stat every entry of the directory.\n"
+"    `streaming-read` - read the file sequentially to EOF.\n"
+"    `small-file-write` - create, write and remove small files in the\n"
+"      directory.\n"
+"    `scan` - read the directory with readdirplus.\n"
+"iterations : int, optional, default=3\n"
+"    Number of times to run the workload on each context.\n\n"
+"Returns\n"
+"-------\n"
+"dict\n"
+"    `results` maps profile name, or `default` for none, to seconds.\n"
+"    `best` is the name with the lowest time.\n"
+);
+
+static PyObject *py_glfs_benchmark_profiles(PyObject *obj,
+					    PyObject *args,
+					    PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	const char *path = NULL;
+	const char *workload = NULL;
+	int iterations = 3;
+	const char *kwnames [] = { "path", "workload", "iterations", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ss|i",
+					 discard_const_p(char *, kwnames),
+					 &path, &workload, &iterations)) {
+		return NULL;
+	}
+
+	if (self->closed) {
+		PyErr_SetString(PyExc_ValueError, "Volume is closed.");
+		return NULL;
+	}
+
+	return pyglfs_profile_benchmark(self, path, workload, iterations);
+}
+
+PyDoc_STRVAR(py_glfs_close__doc__,
+"close(wait=False)\n"
+"--\n\n"
+"Close the volume and its shards. Further operations on the volume\n"
+"raise ValueError. The glfs_t is released once handles and watches\n"
+"of the volume are released, immediately if there are none. It is\n"
+"finalized on the background reaper thread unless `wait` is set and\n"
+"the context is released by this call.\n\n"
+"Parameters\n"
+"----------\n"
+"wait : bool, optional, default=False\n"
+"    Finalize glfs_t before returning.\n\n"
+"Returns\n"
+"-------\n"
+"None\n"
+);
+
+static PyObject *py_glfs_close(PyObject *obj,
+			       PyObject *args,
+			       PyObject *kwargs)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	bool wait = false;
+	Py_ssize_t i, n;
+	const char *kwnames [] = { "wait", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|b",
+					 discard_const_p(char *, kwnames),
+					 &wait)) {
+		return NULL;
+	}
+
+	n = (self->shards != NULL) ? PyTuple_GET_SIZE(self->shards) : 0;
+	for (i = -1; i < n; i++) {
+		py_glfs_t *vol = (i == -1) ? self :
+		    (py_glfs_t *)PyTuple_GET_ITEM(self->shards, i);
+
+		if (vol->closed) {
+			continue;
+		}
+
+		vol->closed = true;
+		if (vol->nholds == 0) {
+			volume_close_ctx(vol, wait);
+		}
+	}
+
+	Py_RETURN_NONE;
+}
+
 static PyMethodDef py_glfs_volume_methods[] = {
+	{
+		.ml_name = "benchmark_profiles",
+		.ml_meth = (PyCFunction)py_glfs_benchmark_profiles,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_benchmark_profiles__doc__
+	},
+	{
+		.ml_name = "close",
+		.ml_meth = (PyCFunction)py_glfs_close,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_close__doc__
+	},
+	{
+		.ml_name = "connect",
+		.ml_meth = (PyCFunction)py_glfs_connect,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_connect__doc__
+	},
+	{
+		.ml_name = "connect_async",
+		.ml_meth = (PyCFunction)py_glfs_connect_async,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_connect_async__doc__
+	},
 	{
 		.ml_name = "get_root_handle",
 		.ml_meth = (PyCFunction)py_glfs_get_root,
@@ -694,6 +2061,18 @@ static PyMethodDef py_glfs_volume_methods[] = {
 		.ml_flags = METH_VARARGS,
 		.ml_doc = py_glfs_open_by_uuid__doc__
 	},
+	{
+		.ml_name = "open_many_by_uuid",
+		.ml_meth = (PyCFunction)py_glfs_open_many_by_uuid,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_open_many_by_uuid__doc__
+	},
+	{
+		.ml_name = "watch",
+		.ml_meth = (PyCFunction)py_glfs_watch,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_watch__doc__
+	},
 	{
 		.ml_name = "getcwd",
 		.ml_meth = (PyCFunction)py_glfs_getcwd,
@@ -736,7 +2115,89 @@ PyDoc_STRVAR(py_glfs_get_xlators__doc__,
 "Each list entry is a tuple of strings: (<name of the xlator>, <key>, <value>)\n"
 );
 
+PyDoc_STRVAR(py_glfs_get_cache_stats__doc__,
+"Statistics for client-side caches of the virtual mount.\n"
+"Dict keyed by cache name. Value is None if cache is disabled, otherwise\n"
+"a dict containing `hits`, `misses`, `evictions`, `invalidations`,\n"
+"`entries`, `max_entries`, `bytes` (size of cached values),\n"
+"`max_bytes` (0 if unlimited), and `ttl` (seconds).\n"
+"The `disk` key holds statistics for the index of the disk cache, where\n"
+"`bytes` is the total size of cached files.\n"
+"The `fd_pool` key holds statistics for the pool of idle fds, where\n"
+"`hits` counts opens served from the pool.\n"
+"The `upcall` key holds counters for inode invalidation events received\n"
+"from the servers, or None if upcalls are not registered.\n"
+);
+
+PyDoc_STRVAR(py_glfs_get_profile__doc__,
+"Name of the xlator option profile of the virtual mount, or None.\n"
+);
+
+PyDoc_STRVAR(py_glfs_get_shards__doc__,
+"Number of glfs_t contexts used by the virtual mount.\n"
+"Cache statistics, logging and watch() refer to the first context.\n"
+);
+
+PyDoc_STRVAR(py_glfs_get_ready__doc__,
+"True if the volume and its shards are connected. Completes a finished\n"
+"background connect, and raises its error if it failed.\n"
+);
+
+static PyObject *py_glfs_get_ready(PyObject *obj, void *closure)
+{
+	py_glfs_t *self = (py_glfs_t *)obj;
+	Py_ssize_t i, n;
+	bool done;
+
+	n = (self->shards != NULL) ? PyTuple_GET_SIZE(self->shards) : 0;
+	for (i = -1; i < n; i++) {
+		py_glfs_t *vol = (i == -1) ? self :
+		    (py_glfs_t *)PyTuple_GET_ITEM(self->shards, i);
+
+		if (vol->closed) {
+			Py_RETURN_FALSE;
+		}
+
+		if (vol->fs != NULL) {
+			continue;
+		}
+
+		if (vol->connect == NULL) {
+			Py_RETURN_FALSE;
+		}
+
+		pthread_mutex_lock(&vol->connect->lock);
+		done = vol->connect->done;
+		pthread_mutex_unlock(&vol->connect->lock);
+
+		if (!done) {
+			Py_RETURN_FALSE;
+		}
+
+		if (!volume_connect(vol)) {
+			return NULL;
+		}
+	}
+
+	Py_RETURN_TRUE;
+}
+
 static PyGetSetDef py_glfs_volume_getsetters[] = {
+	{
+		.name    = discard_const_p(char, "ready"),
+		.get     = (getter)py_glfs_get_ready,
+		.doc     = py_glfs_get_ready__doc__,
+	},
+	{
+		.name    = discard_const_p(char, "profile"),
+		.get     = (getter)py_glfs_get_profile,
+		.doc     = py_glfs_get_profile__doc__,
+	},
+	{
+		.name    = discard_const_p(char, "shards"),
+		.get     = (getter)py_glfs_get_shards,
+		.doc     = py_glfs_get_shards__doc__,
+	},
 	{
 		.name    = discard_const_p(char, "name"),
 		.get     = (getter)py_glfs_get_volume_name,
@@ -762,6 +2223,11 @@ static PyGetSetDef py_glfs_volume_getsetters[] = {
 		.get     = (getter)py_glfs_get_xlators,
 		.doc     = py_glfs_get_xlators__doc__,
 	},
+	{
+		.name    = discard_const_p(char, "cache_stats"),
+		.get     = (getter)py_glfs_get_cache_stats,
+		.doc     = py_glfs_get_cache_stats__doc__,
+	},
 	{ .name = NULL }
 };
 
@@ -787,7 +2253,97 @@ PyDoc_STRVAR(py_glfs_volume__doc__,
 "  already exist (provided system permissions allow).\n"
 "  If this is not specified then a new logfile will be created in default log\n"
 "  directory associated with the glusterfs installation.\n\n"
-":log_level: Int specifying the degree of logging verbosity.\n"
+":log_level: Int specifying the degree of logging verbosity.\n\n"
+":attr_cache_ttl: Float seconds for which stat information of objects is\n"
+"  cached client-side, keyed by gfid. The cache is fed by stat(),\n"
+"  lookups and directory iteration with stat enabled, and is invalidated\n"
+"  by operations through pyglfs that change attributes. Changes made\n"
+"  by other clients are not seen until the entry expires.\n"
+"  Default of 0 disables the cache.\n\n"
+":attr_cache_size: Maximum number of entries in the attribute cache.\n\n"
+":dentry_cache_ttl: Float seconds for which results of path resolution are\n"
+"  cached client-side as (parent gfid, name) -> gfid entries. Names that\n"
+"  do not exist are cached as negative entries. The cache is updated by\n"
+"  lookup(), create(), mkdir() and unlink(). Symlinks are not cached.\n"
+"  Default of 0 disables the cache.\n\n"
+":dentry_cache_size: Maximum number of entries in the dentry cache.\n\n"
+":block_cache_ttl: Float seconds for which file data read through FD.pread()\n"
+"  is cached client-side in blocks keyed by (gfid, block number). The\n"
+"  cache is shared by all FDs of the volume, and sequential reads\n"
+"  through an FD read ahead into the cache. Writes and truncates through\n"
+"  pyglfs drop cached blocks of the file. Default of 0 disables the cache.\n\n"
+":block_cache_size: Maximum number of bytes of file data cached.\n"
+"  Default is 64 MiB.\n\n"
+":block_cache_block_size: Size in bytes of cached blocks. Default is 128 KiB.\n\n"
+":fd_pool_ttl: Float seconds for which the glfs fd of a closed FD is kept\n"
+"  open and reused by the next ObjectHandle.open() of the same file with\n"
+"  the same flags, saving the open and close round trips. Pooled fds are\n"
+"  rewound to offset 0. Only read-only opens are pooled; opens with\n"
+"  O_DIRECTORY or `lease_cache`, and FDs that took POSIX locks, are\n"
+"  not pooled. Pooled fds of a file are closed when it is unlinked\n"
+"  through pyglfs or changed by another client, and all are closed when\n"
+"  the volume is closed. Default of 0 disables the pool.\n\n"
+":fd_pool_size: Maximum number of idle fds in the pool. Default is 128.\n\n"
+":disk_cache_dir: Local directory in which to keep copies of files read\n"
+"  through the volume. Files opened read-only are checked against the\n"
+"  cache and, if size, mtime and ctime match, reads are served from the\n"
+"  local copy. Otherwise a file that is read sequentially from start to\n"
+"  EOF is added to the cache. The cache persists across restarts.\n"
+"  Default of None disables the cache.\n\n"
+":disk_cache_size: Maximum number of bytes of files kept in the disk\n"
+"  cache. Least recently used files are removed. Default is 1 GiB.\n\n"
+":intern_handles: Return the existing live ObjectHandle when an object\n"
+"  that already has one is looked up or opened by uuid, rather than\n"
+"  creating a duplicate handle with its own inode reference. The stat\n"
+"  information of the handle is refreshed and its name is that of the\n"
+"  first lookup. Not supported with `shards`. Default is False.\n\n"
+":shards: Number of independent glfs_t contexts (client graphs, each with\n"
+"  its own event threads and brick connections) to initialize with the\n"
+"  same parameters. get_root_handle() spreads handles round-robin across\n"
+"  the contexts, and open_by_uuid() selects one by hash of the uuid.\n"
+"  Handles and FDs stay with the context that created them. Caches and\n"
+"  their size limits are per context. Not supported with\n"
+"  `disk_cache_dir` or `intern_handles`. Default is 1.\n\n"
+":shared: Reuse the initialized glfs_t of another live Volume created with\n"
+"  the same volume name, volfile servers, xlators and logging parameters,\n"
+"  rather than fetching the volfile and connecting to the bricks again.\n"
+"  Only Volumes that also set `shared` are reused. The context is\n"
+"  finalized when the last Volume using it is released. Volumes sharing\n"
+"  a context also share its working directory (fchdir() / getcwd()),\n"
+"  graph and logging state, so do not share Volumes that rely on\n"
+"  cwd-relative paths. Ignored when `shards` is greater than 1.\n"
+"  Default is False.\n\n"
+":volfile_cache: Path of a local copy of the volfile. If the file exists the\n"
+"  volume is mounted from it without contacting the volfile servers. If\n"
+"  it is missing or the mount fails, the volfile is fetched from the\n"
+"  servers and the local copy is replaced after a successful mount.\n"
+"  A volume mounted from the local copy is not notified of volfile\n"
+"  changes; remove the file to pick them up. Default of None disables.\n\n"
+":lazy: Return without connecting. The volume is connected on first use,\n"
+"  by connect(), or in the background by connect_async(). Parameters\n"
+"  are validated immediately but connection errors are raised by the\n"
+"  first use. `uuid` is empty until connected. Default is False.\n\n"
+":background_fini: Finalize the glfs_t on a native reaper thread when the\n"
+"  volume is released, so that dropping the last reference does not\n"
+"  block while client threads and graph are torn down. pyglfs.drain()\n"
+"  waits for pending finalization. Default is True.\n\n"
+":profile: Name of a preset of client xlator options tuned for a kind of\n"
+"  workload. Options given in `xlators` take precedence. Options for\n"
+"  xlators that are not in the client graph have no effect. The options\n"
+"  of each profile are listed in pyglfs.PROFILES.\n"
+"  `metadata-heavy` - long md-cache timeouts, readdirp and lookup-optimize\n"
+"    for lookup and stat dominated workloads.\n"
+"  `streaming-read` - deep read-ahead, large io-cache and more event\n"
+"    threads for sequential reads of large files.\n"
+"  `small-file-write` - larger write-behind window, flush-behind and\n"
+"    lazy open for creating and writing many small files.\n"
+"  `scan` - large readdir-ahead buffers and readdirplus for directory\n"
+"    traversal.\n"
+"  Default of None applies no options. See also benchmark_profiles().\n\n"
+"If any client-side cache is enabled, pyglfs registers for inode\n"
+"invalidation upcalls and evicts entries changed by other clients. This\n"
+"requires `features.cache-invalidation` to be enabled on the volume,\n"
+"otherwise entries are only refreshed when their TTL expires.\n"
 );
 
 PyTypeObject PyGlfsVolume = {
@@ -0,0 +1,376 @@
+/*
+ * Python language bindings for libgfapi
+ *
+ * Copyright (C) Andrew Walker, 2022
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Python.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "includes.h"
+#include "pyglfs.h"
+
+/*
+ * Change notification stream. Upcall events are queued by the upcall
+ * dispatcher thread and the eventfd is made readable when the queue
+ * becomes non-empty. Python consumers select / poll on fileno() and
+ * then call read_events().
+ */
+typedef struct {
+	PyObject_HEAD
+	py_glfs_t *py_fs;
+	int efd;
+	bool subscribed;
+	pthread_mutex_t lock;	/* protects queue */
+	pyglfs_upcall_event_t *queue;
+	size_t head;
+	size_t cnt;
+	size_t max_events;
+	bool overflow;
+} py_glfs_watch_t;
+
+static void watch_upcall_cb(const pyglfs_upcall_event_t *events,
+			    size_t cnt, void *private)
+{
+	py_glfs_watch_t *self = (py_glfs_watch_t *)private;
+	bool was_empty;
+	size_t i;
+
+	pthread_mutex_lock(&self->lock);
+	was_empty = (self->cnt == 0) && !self->overflow;
+
+	for (i = 0; i < cnt; i++) {
+		if ((events[i].flags & PYGLFS_UPCALL_OVERFLOW) ||
+		    (self->cnt == self->max_events)) {
+			self->overflow = true;
+			break;
+		}
+		self->queue[(self->head + self->cnt) % self->max_events] = events[i];
+		self->cnt++;
+	}
+
+	if (was_empty) {
+		uint64_t one = 1;
+
+		if (write(self->efd, &one, sizeof(one)) == -1) {
+			fprintf(stderr, "eventfd write failed: %s\n",
+				strerror(errno));
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+}
+
+static void watch_stop(py_glfs_watch_t *self)
+{
+	if (self->subscribed) {
+		Py_BEGIN_ALLOW_THREADS
+		pyglfs_upcall_unsubscribe(self->py_fs->upcall,
+					  watch_upcall_cb, self);
+		Py_END_ALLOW_THREADS
+		self->subscribed = false;
+	}
+
+	if (self->efd != -1) {
+		close(self->efd);
+		self->efd = -1;
+	}
+}
+
+static PyObject *py_glfs_watch_new(PyTypeObject *obj,
+				   PyObject *args_unused,
+				   PyObject *kwargs_unused)
+{
+	py_glfs_watch_t *self = NULL;
+
+	self = (py_glfs_watch_t *)obj->tp_alloc(obj, 0);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	self->efd = -1;
+	pthread_mutex_init(&self->lock, NULL);
+	return (PyObject *)self;
+}
+
+static int py_glfs_watch_init(PyObject *obj,
+			      PyObject *args,
+			      PyObject *kwargs)
+{
+	return 0;
+}
+
+void py_glfs_watch_dealloc(py_glfs_watch_t *self)
+{
+	watch_stop(self);
+	pthread_mutex_destroy(&self->lock);
+	free(self->queue);
+	if (self->py_fs != NULL) {
+		pyglfs_volume_release(self->py_fs);
+		self->py_fs = NULL;
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *init_glfs_watch(py_glfs_t *py_fs, size_t max_events)
+{
+	py_glfs_watch_t *self = NULL;
+	pyglfs_upcall_t *up = NULL;
+
+	up = pyglfs_get_upcall(py_fs);
+	if (up == NULL) {
+		return NULL;
+	}
+
+	self = (py_glfs_watch_t *)PyObject_CallNoArgs((PyObject *)&PyGlfsWatch);
+	if (self == NULL) {
+		return NULL;
+	}
+
+	pyglfs_volume_hold(py_fs);
+	self->py_fs = py_fs;
+	self->max_events = max_events;
+
+	self->queue = calloc(max_events, sizeof(pyglfs_upcall_event_t));
+	if (self->queue == NULL) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+
+	self->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (self->efd == -1) {
+		set_exc_from_errno("eventfd()");
+		Py_DECREF(self);
+		return NULL;
+	}
+
+	if (!pyglfs_upcall_subscribe(up, watch_upcall_cb, self)) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+	self->subscribed = true;
+
+	return (PyObject *)self;
+}
+
+static PyObject *gfid_to_pystr(const unsigned char *gfid)
+{
+	char uuid_str[37];
+
+	if (uuid_is_null(gfid)) {
+		Py_RETURN_NONE;
+	}
+
+	uuid_unparse(gfid, uuid_str);
+	return PyUnicode_FromString(uuid_str);
+}
+
+static PyObject *event_to_pydict(const pyglfs_upcall_event_t *ev)
+{
+	return Py_BuildValue(
+		"{s:N,s:K,s:N,s:N}",
+		"uuid", gfid_to_pystr(ev->gfid),
+		"flags", (unsigned long long)ev->flags,
+		"parent_uuid", gfid_to_pystr(ev->pgfid),
+		"oldparent_uuid", gfid_to_pystr(ev->oldpgfid)
+	);
+}
+
+PyDoc_STRVAR(py_glfs_watch_read_events__doc__,
+"read_events(max=256)\n"
+"--\n\n"
+"Retrieve pending change notifications. Does not block.\n"
+"fileno() becomes readable when events are pending and stays\n"
+"readable until all of them have been retrieved.\n\n"
+"Parameters\n"
+"----------\n"
+"max : int, optional, default=256\n"
+"    Maximum number of events to return.\n\n"
+"Returns\n"
+"-------\n"
+"events : list\n"
+"    List of dicts containing `uuid` of the changed object, `flags`\n"
+"    (bitmask of pyglfs.UP_* constants), and `parent_uuid` and\n"
+"    `oldparent_uuid` when provided by the server (otherwise None).\n"
+"    If events were lost because the queue was full, the list ends\n"
+"    with an event with `uuid` None and flags of pyglfs.UP_OVERFLOW,\n"
+"    after which consumer should assume that anything may have changed.\n"
+);
+
+static PyObject *py_glfs_watch_read_events(PyObject *obj,
+					   PyObject *args,
+					   PyObject *kwargs)
+{
+	py_glfs_watch_t *self = (py_glfs_watch_t *)obj;
+	pyglfs_upcall_event_t *events = NULL;
+	PyObject *out = NULL;
+	Py_ssize_t max = 256;
+	size_t cnt = 0, i;
+	bool overflow = false;
+	const char *kwnames [] = { "max", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n",
+					 discard_const_p(char *, kwnames),
+					 &max)) {
+		return NULL;
+	}
+
+	if (max < 1) {
+		PyErr_SetString(PyExc_ValueError,
+				"max must be at least one event");
+		return NULL;
+	}
+
+	if (self->efd == -1) {
+		PyErr_SetString(PyExc_ValueError, "watch is closed");
+		return NULL;
+	}
+
+	events = calloc(Py_MIN((size_t)max, self->max_events),
+			sizeof(pyglfs_upcall_event_t));
+	if (events == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	pthread_mutex_lock(&self->lock);
+	while ((cnt < (size_t)max) && self->cnt) {
+		events[cnt++] = self->queue[self->head];
+		self->head = (self->head + 1) % self->max_events;
+		self->cnt--;
+	}
+
+	if ((self->cnt == 0) && self->overflow && (cnt < (size_t)max)) {
+		overflow = true;
+		self->overflow = false;
+	}
+
+	if ((self->cnt == 0) && !self->overflow) {
+		uint64_t val;
+
+		/* drained. reset eventfd so that it's no longer readable */
+		if ((read(self->efd, &val, sizeof(val)) == -1) &&
+		    (errno != EAGAIN)) {
+			fprintf(stderr, "eventfd read failed: %s\n",
+				strerror(errno));
+		}
+	}
+	pthread_mutex_unlock(&self->lock);
+
+	out = PyList_New(cnt + (overflow ? 1 : 0));
+	if (out == NULL) {
+		free(events);
+		return NULL;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		PyObject *ev = event_to_pydict(&events[i]);
+		if (ev == NULL) {
+			Py_CLEAR(out);
+			free(events);
+			return NULL;
+		}
+		PyList_SET_ITEM(out, i, ev);
+	}
+	free(events);
+
+	if (overflow) {
+		pyglfs_upcall_event_t ev = { .flags = PYGLFS_UPCALL_OVERFLOW };
+		PyObject *pyev = event_to_pydict(&ev);
+
+		if (pyev == NULL) {
+			Py_CLEAR(out);
+			return NULL;
+		}
+		PyList_SET_ITEM(out, cnt, pyev);
+	}
+
+	return out;
+}
+
+PyDoc_STRVAR(py_glfs_watch_fileno__doc__,
+"fileno()\n"
+"--\n\n"
+"File descriptor that becomes readable when events are pending.\n"
+"Suitable for use with select, poll, epoll and asyncio add_reader().\n"
+"The file descriptor must not be read directly.\n\n"
+"Returns\n"
+"-------\n"
+"int\n"
+);
+
+static PyObject *py_glfs_watch_fileno(PyObject *obj,
+				      PyObject *args_unused,
+				      PyObject *kwargs_unused)
+{
+	py_glfs_watch_t *self = (py_glfs_watch_t *)obj;
+
+	if (self->efd == -1) {
+		PyErr_SetString(PyExc_ValueError, "watch is closed");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->efd);
+}
+
+PyDoc_STRVAR(py_glfs_watch_close__doc__,
+"close()\n"
+"--\n\n"
+"Stop delivery of events and close the file descriptor.\n\n"
+"Returns\n"
+"-------\n"
+"None\n"
+);
+
+static PyObject *py_glfs_watch_close(PyObject *obj,
+				     PyObject *args_unused,
+				     PyObject *kwargs_unused)
+{
+	watch_stop((py_glfs_watch_t *)obj);
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef py_glfs_watch_methods[] = {
+	{
+		.ml_name = "read_events",
+		.ml_meth = (PyCFunction)py_glfs_watch_read_events,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_glfs_watch_read_events__doc__
+	},
+	{
+		.ml_name = "fileno",
+		.ml_meth = (PyCFunction)py_glfs_watch_fileno,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_watch_fileno__doc__
+	},
+	{
+		.ml_name = "close",
+		.ml_meth = (PyCFunction)py_glfs_watch_close,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = py_glfs_watch_close__doc__
+	},
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject PyGlfsWatch = {
+	.tp_name = "pyglfs.Watch",
+	.tp_basicsize = sizeof(py_glfs_watch_t),
+	.tp_methods = py_glfs_watch_methods,
+	.tp_new = py_glfs_watch_new,
+	.tp_init = py_glfs_watch_init,
+	.tp_doc = "Glusterfs change notification stream",
+	.tp_dealloc = (destructor)py_glfs_watch_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+};
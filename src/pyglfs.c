@@ -69,9 +69,101 @@ simple_err:
 }
 
 
+/* flags of events reported by pyglfs.Watch */
+static bool add_upcall_constants(PyObject *m)
+{
+	PyObject *overflow = NULL;
+
+	if ((PyModule_AddIntConstant(m, "UP_NLINK", GFAPI_UP_NLINK) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_MODE", GFAPI_UP_MODE) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_OWN", GFAPI_UP_OWN) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_SIZE", GFAPI_UP_SIZE) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_TIMES", GFAPI_UP_TIMES) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_ATIME", GFAPI_UP_ATIME) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_PERM", GFAPI_UP_PERM) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_RENAME", GFAPI_UP_RENAME) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_FORGET", GFAPI_UP_FORGET) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_PARENT_TIMES", GFAPI_UP_PARENT_TIMES) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_XATTR", GFAPI_UP_XATTR) < 0) ||
+	    (PyModule_AddIntConstant(m, "UP_XATTR_RM", GFAPI_UP_XATTR_RM) < 0)) {
+		return false;
+	}
+
+	overflow = PyLong_FromUnsignedLongLong(PYGLFS_UPCALL_OVERFLOW);
+	if (overflow == NULL) {
+		return false;
+	}
+
+	if (PyModule_AddObject(m, "UP_OVERFLOW", overflow) < 0) {
+		Py_DECREF(overflow);
+		return false;
+	}
+
+	return true;
+}
+
 #define MODULE_DOC "Minimal libglfs python bindings."
 
-static PyMethodDef glfs_methods[] = { { .ml_name = NULL } };
+PyDoc_STRVAR(py_pyglfs_drain__doc__,
+"drain(timeout=None)\n"
+"--\n\n"
+"Wait for glfs_t contexts of released Volumes to be finalized by the\n"
+"background reaper thread. This is done automatically at interpreter\n"
+"exit.\n\n"
+"Parameters\n"
+"----------\n"
+"timeout : float, optional, default=None\n"
+"    Seconds to wait. None waits until all contexts are finalized.\n\n"
+"Returns\n"
+"-------\n"
+"bool\n"
+"    False if timeout expired first.\n"
+);
+
+static PyObject *py_pyglfs_drain(PyObject *module,
+				 PyObject *args,
+				 PyObject *kwargs)
+{
+	PyObject *pytimeout = Py_None;
+	double timeout = -1;
+	bool idle;
+	const char *kwnames [] = { "timeout", NULL };
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O",
+					 discard_const_p(char *, kwnames),
+					 &pytimeout)) {
+		return NULL;
+	}
+
+	if (pytimeout != Py_None) {
+		timeout = PyFloat_AsDouble(pytimeout);
+		if ((timeout == -1) && PyErr_Occurred()) {
+			return NULL;
+		}
+
+		if (timeout < 0) {
+			PyErr_SetString(PyExc_ValueError,
+					"timeout must be non-negative");
+			return NULL;
+		}
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	idle = pyglfs_reaper_drain(timeout);
+	Py_END_ALLOW_THREADS
+
+	return PyBool_FromLong(idle);
+}
+
+static PyMethodDef glfs_methods[] = {
+	{
+		.ml_name = "drain",
+		.ml_meth = (PyCFunction)py_pyglfs_drain,
+		.ml_flags = METH_VARARGS | METH_KEYWORDS,
+		.ml_doc = py_pyglfs_drain__doc__
+	},
+	{ .ml_name = NULL }
+};
 static struct PyModuleDef moduledef = {
 	PyModuleDef_HEAD_INIT,
 	.m_name = "pyglfs",
@@ -82,7 +174,7 @@ static struct PyModuleDef moduledef = {
 
 PyObject* module_init(void)
 {
-	PyObject *m = NULL;
+	PyObject *m = NULL, *profiles = NULL;
 	m = PyModule_Create(&moduledef);
 	if (m == NULL) {
 		fprintf(stderr, "failed to initalize module\n");
@@ -104,6 +196,18 @@ PyObject* module_init(void)
 	if (PyType_Ready(&PyGlfsFTSENT) < 0)
 		return NULL;
 
+	if (PyType_Ready(&PyGlfsWatch) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PyGlfsDirStream) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PyGlfsDirEntry) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PyGlfsScandirIterator) < 0)
+		return NULL;
+
         if (!init_pystat_type()) {
 		return NULL;
 	}
@@ -126,6 +230,34 @@ PyObject* module_init(void)
 		return NULL;
 	}
 
+	Py_INCREF(&PyGlfsStatResult);
+	if (PyModule_AddObject(m, "stat_result",
+			       (PyObject *)&PyGlfsStatResult) < 0) {
+		Py_DECREF(&PyGlfsStatResult);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	if (!add_upcall_constants(m)) {
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	profiles = pyglfs_profiles_to_dict();
+	if ((profiles == NULL) ||
+	    (PyModule_AddObject(m, "PROFILES", profiles) < 0)) {
+		Py_XDECREF(profiles);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	if (!pyglfs_reaper_init()) {
+		PyErr_SetString(PyExc_RuntimeError,
+				"failed to register exit handler");
+		Py_DECREF(m);
+		return NULL;
+	}
+
 	return m;
 }
 
@@ -30,24 +30,102 @@ typedef struct glfs_volfile_server {
 	int port;
 } glfs_volfile_server_t;
 
+/*
+ * Compact copy of struct stat kept on handles. Times are nanoseconds
+ * since the epoch.
+ */
+typedef struct {
+	uint64_t st_ino;
+	uint64_t st_dev;
+	uint64_t st_rdev;
+	int64_t st_size;
+	int64_t st_blocks;
+	int64_t st_atime_ns;
+	int64_t st_mtime_ns;
+	int64_t st_ctime_ns;
+	uint32_t st_mode;
+	uint32_t st_nlink;
+	uint32_t st_uid;
+	uint32_t st_gid;
+	uint32_t st_blksize;
+	uint32_t valid;	/* no padding, so copies compare with memcmp */
+} pyglfs_stat_t;
+
+typedef struct pyglfs_cache pyglfs_cache_t;
+typedef struct pyglfs_upcall pyglfs_upcall_t;
+typedef struct pyglfs_lease_cache pyglfs_lease_cache_t;
+typedef struct pyglfs_dcache pyglfs_dcache_t;
+typedef struct pyglfs_dcache_fill pyglfs_dcache_fill_t;
+typedef struct pyglfs_handle_table pyglfs_handle_table_t;
+typedef struct pyglfs_connect pyglfs_connect_t;
+typedef struct pyglfs_profile pyglfs_profile_t;
+
+/*
+ * Initialized glfs_t shared by Volumes created with shared=True and
+ * identical connection parameters. Protected by the GIL.
+ */
+typedef struct pyglfs_shared_fs {
+	PyObject *key;
+	glfs_t *fs;
+	struct pyglfs_upcall *upcall;
+	char vol_id[39];
+	size_t refcnt;
+	struct pyglfs_shared_fs *next;
+} pyglfs_shared_fs_t;
+
+#define PYGLFS_DEFAULT_CACHE_ENTRIES 65536
+#define PYGLFS_MAX_SHARDS 64
+
+typedef struct {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invalidations;
+	size_t entries;
+	size_t max_entries;
+	size_t bytes;
+	size_t max_bytes;
+	uint64_t ttl_ns;
+} pyglfs_cache_stats_t;
+
 typedef struct {
 	PyObject_HEAD
 	PyObject *xlators;
+	const pyglfs_profile_t *profile;	/* NULL if none */
 	glfs_t *fs;
+	pyglfs_cache_t *attr_cache;
+	pyglfs_cache_t *dentry_cache;
+	pyglfs_cache_t *block_cache;
+	size_t block_size;
+	uint64_t block_cache_gen;	/* bumped by invalidations */
+	pyglfs_cache_t *fd_pool;
+	pyglfs_dcache_t *disk_cache;
+	pyglfs_handle_table_t *handles;	/* NULL if interning disabled */
+	pyglfs_upcall_t *upcall;	/* owned by `shared` if set */
+	pyglfs_shared_fs_t *shared;
+	bool share_ctx;		/* use shared registry on connect */
+	pyglfs_connect_t *connect;	/* pending connect, or NULL */
+	size_t nholds;		/* handles and watches using fs */
+	bool closed;
+	bool background_fini;	/* glfs_fini() on reaper thread */
+	PyObject *shards;	/* tuple of additional Volumes, or NULL */
+	size_t next_shard;
 	char name[NAME_MAX + 1]; /* GD_VOLUME_NAME_MAX */;
 	glfs_volfile_server_t *volfile_servers;
 	size_t srv_cnt;
 	char log_file[PATH_MAX];
+	char volfile_cache[PATH_MAX];
 	char vol_id[39]; /* GF_UUID_BUF_SIZE + 1 */
 	int log_level;
 } py_glfs_t;
 
-typedef struct {
+typedef struct py_glfs_obj {
 	PyObject_HEAD
 	PyObject *name;
 	py_glfs_t *py_fs;
-	struct stat st;
-	char uuid_str[37];
+	pyglfs_stat_t st;
+	PyObject *pystat;	/* stat_result built from st */
+	uuid_t gfid;
 	glfs_object_t *gl_obj;
 } py_glfs_obj_t;
 
@@ -56,6 +134,14 @@ typedef struct {
 	glfs_fd_t *fd;
 	py_glfs_obj_t *parent;
 	int flags;
+	bool errno_mode;
+	pyglfs_lease_cache_t *lease_cache;
+	off_t seq_next;		/* sequential read detection */
+	unsigned int seq_run;
+	int dc_fd;		/* local copy in disk cache */
+	pyglfs_dcache_fill_t *dc_fill;
+	pyglfs_stat_t last_st;	/* post-op attributes of last fop */
+	bool poolable;		/* return fd to Volume FD pool on close */
 } py_glfs_fd_t;
 
 /*
@@ -102,6 +188,59 @@ typedef struct glfs_object_cb {
 	| PYGLFS_FTS_FLAG_DO_STAT \
 	| PYGLFS_FTS_FLAG_DO_RECURSE
 
+/*
+ * Type-level freelist for small objects that are allocated in large
+ * numbers. Only objects of exactly the given type are recycled.
+ * Protected by the GIL.
+ */
+#define PYGLFS_FREELIST_MAX 1024
+
+typedef struct {
+	PyObject *items[PYGLFS_FREELIST_MAX];
+	size_t cnt;
+} pyglfs_freelist_t;
+
+static inline PyObject *pyglfs_freelist_alloc(pyglfs_freelist_t *fl,
+					      PyTypeObject *base,
+					      PyTypeObject *type)
+{
+	PyObject *op = NULL;
+
+	if ((type != base) || (fl->cnt == 0)) {
+		return type->tp_alloc(type, 0);
+	}
+
+	op = fl->items[--fl->cnt];
+	memset(op, 0, type->tp_basicsize);
+	return PyObject_Init(op, type);
+}
+
+static inline void pyglfs_freelist_free(pyglfs_freelist_t *fl,
+					PyTypeObject *base,
+					PyObject *op)
+{
+	if ((Py_TYPE(op) != base) || (fl->cnt == PYGLFS_FREELIST_MAX)) {
+		Py_TYPE(op)->tp_free(op);
+		return;
+	}
+
+	fl->items[fl->cnt++] = op;
+}
+
+/* FNV-1a hash used for in-memory name tables */
+static inline uint64_t pyglfs_hash(const void *data, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
 extern PyTypeObject PyGlfsObject;
 extern PyTypeObject PyGlfsVolume;
 extern PyTypeObject PyGlfsObject;
@@ -110,6 +249,11 @@ extern PyTypeObject PyGlfsFd;
 extern PyTypeObject PyGlfsObjectIter;
 extern PyTypeObject PyGlfsFTS;
 extern PyTypeObject PyGlfsFTSENT;
+extern PyTypeObject PyGlfsWatch;
+extern PyTypeObject PyGlfsDirStream;
+extern PyTypeObject PyGlfsDirEntry;
+extern PyTypeObject PyGlfsScandirIterator;
+extern PyTypeObject PyGlfsStatResult;
 
 extern void _set_glfs_exc(const char *additional_info, const char *location);
 #define set_glfs_exc(additional_info) _set_glfs_exc(additional_info, __location__)
@@ -117,14 +261,192 @@ extern void _set_glfs_exc(const char *additional_info, const char *location);
 extern void set_exc_from_errno(const char *func);
 extern bool init_pystat_type(void);
 extern PyObject *stat_to_pystat(struct stat *st);
+extern void pyglfs_stat_pack(pyglfs_stat_t *dst, const struct stat *st);
+extern void pyglfs_stat_unpack(const pyglfs_stat_t *src, struct stat *st);
+extern PyObject *compact_stat_to_pystat(const pyglfs_stat_t *src);
 extern PyObject *py_file_type_str(mode_t mode);
 
 extern int iter_glfs_object_handle(py_glfs_obj_t *root, glfs_object_cb_t *cb);
 extern bool iter_cb_cleanup(glfs_object_cb_t *cb);
 
+/* bulk operations that dispatch glfs calls from native threads */
+#define PYGLFS_MAX_JOB_THREADS 64
+typedef void (*pyglfs_job_fn_t)(size_t idx, void *private);
+extern void pyglfs_run_jobs(size_t njobs, size_t nthreads,
+			    pyglfs_job_fn_t fn, void *private);
+extern bool pyglfs_check_threads(int threads);
+
+/* background glfs_fini() and deferred jobs, see pyglfs-reaper.c */
+extern bool pyglfs_reaper_init(void);
+extern bool pyglfs_reaper_queue(glfs_t *fs, pyglfs_upcall_t *upcall);
+typedef void (*pyglfs_reaper_fn_t)(void *data);
+extern bool pyglfs_reaper_queue_job(pyglfs_reaper_fn_t fn, void *data);
+extern bool pyglfs_reaper_drain(double timeout);
+
+/* xlator option presets, see pyglfs-profile.c */
+extern const pyglfs_profile_t *pyglfs_profile_lookup(const char *name);
+extern const char *pyglfs_profile_name(const pyglfs_profile_t *profile);
+extern bool pyglfs_profile_apply(const pyglfs_profile_t *profile, glfs_t *fs);
+extern PyObject *pyglfs_profiles_to_dict(void);
+extern PyObject *pyglfs_profile_benchmark(py_glfs_t *self, const char *path,
+					  const char *workload, int iterations);
+
+/* objects that keep the Volume's glfs_t in use */
+extern void pyglfs_volume_hold(py_glfs_t *py_fs);
+extern void pyglfs_volume_release(py_glfs_t *py_fs);
+
+/* client-side caches, see pyglfs-cache.c */
+extern uint64_t pyglfs_now_ns(void);
+extern pyglfs_cache_t *pyglfs_cache_new(size_t max_entries, uint64_t ttl_ns);
+extern void pyglfs_cache_free(pyglfs_cache_t *cache);
+extern void pyglfs_cache_set_max_bytes(pyglfs_cache_t *cache, size_t max_bytes);
+typedef void (*pyglfs_cache_evict_fn_t)(const void *key, size_t klen,
+					const void *val, size_t vlen,
+					void *private);
+extern void pyglfs_cache_set_evict_cb(pyglfs_cache_t *cache,
+				      pyglfs_cache_evict_fn_t fn,
+				      void *private);
+extern bool pyglfs_cache_get(pyglfs_cache_t *cache,
+			     const void *key, size_t klen,
+			     void *val, size_t vlen);
+extern ssize_t pyglfs_cache_get_range(pyglfs_cache_t *cache,
+				      const void *key, size_t klen,
+				      void *buf, size_t off, size_t len);
+extern bool pyglfs_cache_put(pyglfs_cache_t *cache,
+			     const void *key, size_t klen,
+			     const void *val, size_t vlen);
+extern bool pyglfs_cache_put_cost(pyglfs_cache_t *cache,
+				  const void *key, size_t klen,
+				  const void *val, size_t vlen,
+				  size_t cost);
+extern bool pyglfs_cache_take(pyglfs_cache_t *cache,
+			      const void *key, size_t klen,
+			      void *val, size_t vlen);
+extern size_t pyglfs_cache_expire(pyglfs_cache_t *cache);
+extern bool pyglfs_cache_remove(pyglfs_cache_t *cache,
+				const void *key, size_t klen);
+extern void pyglfs_cache_clear(pyglfs_cache_t *cache);
+typedef bool (*pyglfs_cache_match_fn_t)(const void *key, size_t klen,
+					const void *val, size_t vlen,
+					void *private);
+extern size_t pyglfs_cache_remove_if(pyglfs_cache_t *cache,
+				     pyglfs_cache_match_fn_t match,
+				     void *private);
+extern void pyglfs_cache_get_stats(pyglfs_cache_t *cache,
+				   pyglfs_cache_stats_t *stats);
+extern PyObject *pyglfs_cache_stats_to_dict(pyglfs_cache_t *cache);
+
+extern void pyglfs_attr_cache_put(py_glfs_t *py_fs,
+				  const unsigned char *gfid,
+				  const struct stat *st);
+extern bool pyglfs_attr_cache_get(py_glfs_t *py_fs,
+				  const unsigned char *gfid,
+				  struct stat *st);
+extern void pyglfs_attr_cache_invalidate(py_glfs_t *py_fs,
+					 const unsigned char *gfid);
+
+/* child of NULL inserts negative entry */
+extern void pyglfs_dentry_cache_put(py_glfs_t *py_fs,
+				    const unsigned char *parent,
+				    const char *name,
+				    size_t len,
+				    const unsigned char *child);
+extern bool pyglfs_dentry_cache_get(py_glfs_t *py_fs,
+				    const unsigned char *parent,
+				    const char *name,
+				    size_t len,
+				    unsigned char *child,
+				    bool *negative);
+extern void pyglfs_dentry_cache_invalidate(py_glfs_t *py_fs,
+					   const unsigned char *parent,
+					   const char *name,
+					   size_t len);
+
+/* upcall dispatcher, see pyglfs-upcall.c */
+typedef struct {
+	uuid_t gfid;
+	uuid_t pgfid;		/* null if not provided */
+	uuid_t oldpgfid;	/* null if not provided */
+	uint64_t flags;		/* GFAPI_UP_* */
+} pyglfs_upcall_event_t;
+
+/* events were dropped, gfids in this event are not set */
+#define PYGLFS_UPCALL_OVERFLOW	(1ULL << 63)
+
+typedef void (*pyglfs_upcall_fn_t)(const pyglfs_upcall_event_t *events,
+				   size_t cnt, void *private);
+extern pyglfs_upcall_t *pyglfs_upcall_new(glfs_t *fs);
+extern pyglfs_upcall_t *pyglfs_get_upcall(py_glfs_t *py_fs);
+extern void pyglfs_upcall_free(pyglfs_upcall_t *up);
+extern bool pyglfs_upcall_subscribe(pyglfs_upcall_t *up,
+				    pyglfs_upcall_fn_t fn,
+				    void *private);
+extern void pyglfs_upcall_unsubscribe(pyglfs_upcall_t *up,
+				      pyglfs_upcall_fn_t fn,
+				      void *private);
+extern PyObject *pyglfs_upcall_stats_to_dict(pyglfs_upcall_t *up);
+extern void pyglfs_cache_upcall_cb(const pyglfs_upcall_event_t *events,
+				   size_t cnt, void *private);
+
+/* volume block cache, see pyglfs-bcache.c */
+#define PYGLFS_DEFAULT_BLOCK_CACHE_BYTES (64 * 1024 * 1024)
+#define PYGLFS_DEFAULT_BLOCK_SIZE (128 * 1024)
+extern ssize_t pyglfs_bcache_pread(py_glfs_fd_t *fd, char *buf,
+				   size_t cnt, off_t offset);
+extern void pyglfs_bcache_invalidate(py_glfs_t *py_fs,
+				     const unsigned char *gfid);
+extern void pyglfs_bcache_invalidate_range(py_glfs_t *py_fs,
+					   const unsigned char *gfid,
+					   uint64_t start, uint64_t end);
+
+/* pool of idle FDs, see pyglfs-fdpool.c */
+#define PYGLFS_DEFAULT_FD_POOL_ENTRIES 128
+extern void pyglfs_fdpool_setup(pyglfs_cache_t *pool);
+extern bool pyglfs_fdpool_eligible(py_glfs_t *py_fs, int flags);
+extern glfs_fd_t *pyglfs_fdpool_get(py_glfs_t *py_fs,
+				    const unsigned char *gfid, int flags);
+extern bool pyglfs_fdpool_put(py_glfs_t *py_fs, const unsigned char *gfid,
+			      int flags, glfs_fd_t *fd);
+extern void pyglfs_fdpool_invalidate(py_glfs_t *py_fs,
+				     const unsigned char *gfid);
+extern void pyglfs_fdpool_invalidate_name(py_glfs_t *py_fs,
+					  const unsigned char *parent,
+					  const char *name);
+
+/* lease-backed read cache, see pyglfs-lease.c */
+#define PYGLFS_DEFAULT_LEASE_CACHE_BYTES (1024 * 1024)
+extern pyglfs_lease_cache_t *pyglfs_lease_cache_new(glfs_fd_t *fd,
+						    const char *lease_id,
+						    size_t max_bytes);
+extern void pyglfs_lease_cache_free(pyglfs_lease_cache_t *lc);
+extern void pyglfs_lease_cache_invalidate(pyglfs_lease_cache_t *lc);
+extern ssize_t pyglfs_lease_cache_pread(pyglfs_lease_cache_t *lc,
+					char *buf, size_t cnt, off_t offset);
+extern PyObject *pyglfs_lease_cache_stats_to_dict(pyglfs_lease_cache_t *lc);
+
+/* persistent disk cache, see pyglfs-dcache.c */
+#define PYGLFS_DEFAULT_DISK_CACHE_BYTES (1024 * 1024 * 1024)
+extern pyglfs_dcache_t *pyglfs_dcache_new(const char *dir, size_t max_bytes);
+extern void pyglfs_dcache_free(pyglfs_dcache_t *dc);
+extern void pyglfs_dcache_attach(py_glfs_fd_t *fd);
+extern void pyglfs_dcache_fill(py_glfs_fd_t *fd, const char *buf,
+			       size_t cnt, ssize_t n, off_t offset);
+extern void pyglfs_dcache_detach(py_glfs_fd_t *fd);
+extern PyObject *pyglfs_dcache_stats_to_dict(pyglfs_dcache_t *dc);
+
+/* handle interning, see pyglfs-handle.c */
+extern pyglfs_handle_table_t *pyglfs_handle_table_new(void);
+extern void pyglfs_handle_table_free(pyglfs_handle_table_t *ht);
+
 extern bool init_glfd(void);
+extern void pyglfs_obj_set_stat(py_glfs_obj_t *hdl, const struct stat *st);
+extern PyObject *pyglfs_obj_get_pystat(py_glfs_obj_t *hdl);
 extern PyObject *init_glfs_object(py_glfs_t *, glfs_object_t *, const struct stat *, const char *);
 extern PyObject *init_glfs_fd(glfs_fd_t *fd_in, py_glfs_obj_t *hdl, int flags);
+extern PyObject *init_glfs_watch(py_glfs_t *py_fs, size_t max_events);
+extern PyObject *init_glfs_dir_stream(py_glfs_obj_t *hdl);
+extern PyObject *pyglfs_dir_listing(py_glfs_obj_t *hdl);
+extern PyObject *init_glfs_scandir(py_glfs_obj_t *hdl, bool do_stat);
 
 /*
  * Macros to take / release GIL in iterator